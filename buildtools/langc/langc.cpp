@@ -0,0 +1,75 @@
+/************************************************************************************
+ * 
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+/* langc: compiles lang.json into lang.bin, the binary language table mapped by the trivia module.
+ * This runs as part of the build, so a bad edit to lang.json fails the build rather than a live reload.
+ */
+
+#include <dpp/nlohmann/json.hpp>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdio>
+#include "../../modules/trivia/lang.h"
+
+using json = nlohmann::json;
+
+int main(int argc, char** argv)
+{
+	if (argc != 3) {
+		std::cerr << "Usage: " << argv[0] << " <lang.json> <lang.bin>" << std::endl;
+		return 1;
+	}
+
+	std::string source = argv[1];
+	std::string target = argv[2];
+	std::string temp = target + ".tmp";
+	try {
+		std::ifstream langfile(source);
+		if (!langfile) {
+			throw std::runtime_error("Can't open file");
+		}
+		json lang;
+		langfile >> lang;
+		std::string blob = lang_table::compile(lang);
+
+		std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+		out.write(blob.data(), blob.length());
+		out.close();
+		if (!out) {
+			throw std::runtime_error("Can't write " + temp);
+		}
+
+		/* Check the result maps cleanly, then replace the old file in one step so a running bot never sees a partial file */
+		lang_table check(temp);
+		if (rename(temp.c_str(), target.c_str()) != 0) {
+			throw std::runtime_error("Can't rename " + temp + " to " + target);
+		}
+		std::cout << "Compiled " << check.size() << " language strings into " << target << std::endl;
+	}
+	catch (const std::exception &e) {
+		std::cerr << source << ": " << e.what() << std::endl;
+		remove(temp.c_str());
+		return 1;
+	}
+	return 0;
+}
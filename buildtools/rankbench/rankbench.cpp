@@ -0,0 +1,161 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+/* rankbench: times and measures the memory of the global rank index at a given number of players.
+ * It fills the four period indexes the way global_ranks::rebuild() does, then builds a second set
+ * alongside the first, as a rebuild does before it swaps them, along with one chunk of query results.
+ *
+ * Usage: rankbench [players]   (default 10000000)
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <map>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <fmt/format.h>
+#include "../../modules/trivia/ranking.h"
+
+/* As db::row, without needing the database library */
+typedef std::map<std::string, std::string> row;
+
+/* Returns a field of /proc/self/status in megabytes, e.g. VmRSS or VmHWM */
+double status_mb(const std::string &field)
+{
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line)) {
+		if (line.compare(0, field.length() + 1, field + ":") == 0) {
+			return std::stod(line.substr(field.length() + 1)) / 1024.0;
+		}
+	}
+	return 0;
+}
+
+double since(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct player_scores_t
+{
+	uint64_t score[RANK_PERIODS];
+};
+
+/* Scores for one player. Lifetime scores fall off exponentially, and only some players have played
+ * this month, week or day.
+ */
+player_scores_t make_scores(std::mt19937_64 &rng)
+{
+	std::uniform_real_distribution<double> u(0.0, 1.0);
+	player_scores_t s;
+	s.score[RANK_LIFETIME] = 1 + (uint64_t)(-std::log(1.0 - u(rng)) * 2000);
+	s.score[RANK_MONTH] = u(rng) < 0.10 ? 1 + (uint64_t)(-std::log(1.0 - u(rng)) * 300) : 0;
+	s.score[RANK_WEEK] = s.score[RANK_MONTH] && u(rng) < 0.5 ? 1 + s.score[RANK_MONTH] / 4 : 0;
+	s.score[RANK_DAY] = s.score[RANK_WEEK] && u(rng) < 0.4 ? 1 + s.score[RANK_WEEK] / 7 : 0;
+	return s;
+}
+
+void fill(score_rank* ranks, uint64_t players, uint64_t seed)
+{
+	std::mt19937_64 rng(seed);
+	for (uint64_t user_id = 1; user_id <= players; ++user_id) {
+		player_scores_t s = make_scores(rng);
+		for (int p = 0; p < RANK_PERIODS; ++p) {
+			ranks[p].set(user_id, s.score[p]);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint64_t players = argc > 1 ? std::stoull(argv[1]) : 10000000;
+	std::mt19937_64 rng(42);
+	std::uniform_int_distribution<uint64_t> any_player(1, players);
+	double base = status_mb("VmRSS");
+
+	score_rank* ranks = new score_rank[RANK_PERIODS];
+	auto start = std::chrono::steady_clock::now();
+	fill(ranks, players, 1);
+	std::cout << fmt::format("players:            {}\n", players);
+	std::cout << fmt::format("load:               {:.2f} s\n", since(start));
+	for (int p = 0; p < RANK_PERIODS; ++p) {
+		static const char* names[RANK_PERIODS] = { "day", "week", "month", "lifetime" };
+		std::cout << fmt::format("  {:<9} indexed:  {}\n", names[p], ranks[p].size());
+	}
+	double loaded = status_mb("VmRSS");
+	std::cout << fmt::format("index memory:       {:.0f} MB\n", loaded - base);
+
+	/* A rebuild holds a chunk of results and a complete second index until it swaps them in */
+	std::vector<row> chunk(RANK_REBUILD_CHUNK);
+	for (size_t i = 0; i < chunk.size(); ++i) {
+		player_scores_t s = make_scores(rng);
+		chunk[i]["name"] = std::to_string(100000000000000000ULL + i);
+		chunk[i]["score"] = std::to_string(s.score[RANK_LIFETIME]);
+		chunk[i]["dayscore"] = std::to_string(s.score[RANK_DAY]);
+		chunk[i]["weekscore"] = std::to_string(s.score[RANK_WEEK]);
+		chunk[i]["monthscore"] = std::to_string(s.score[RANK_MONTH]);
+	}
+	score_rank* fresh = new score_rank[RANK_PERIODS];
+	start = std::chrono::steady_clock::now();
+	fill(fresh, players, 2);
+	std::cout << fmt::format("rebuild in memory:  {:.2f} s\n", since(start));
+	std::cout << fmt::format("rebuild peak:       {:.0f} MB\n", status_mb("VmHWM") - base);
+	delete[] fresh;
+	chunk.clear();
+	chunk.shrink_to_fit();
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < 1000000; ++i) {
+		uint64_t user_id = any_player(rng);
+		for (int p = 0; p < RANK_PERIODS; ++p) {
+			ranks[p].add(user_id, 1 + rng() % 20);
+		}
+	}
+	std::cout << fmt::format("1M score updates:   {:.2f} s\n", since(start));
+
+	start = std::chrono::steady_clock::now();
+	uint64_t sum = 0;
+	for (int i = 0; i < 1000000; ++i) {
+		sum += ranks[RANK_LIFETIME].rank(any_player(rng));
+	}
+	std::cout << fmt::format("1M rank lookups:    {:.2f} s\n", since(start));
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < 10000; ++i) {
+		sum += ranks[RANK_LIFETIME].range((i % 100) * RANK_PAGE_SIZE, RANK_PAGE_SIZE).size();
+	}
+	std::cout << fmt::format("10k top-1000 pages: {:.3f} s\n", since(start));
+
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < 1000; ++i) {
+		sum += ranks[RANK_LIFETIME].range(rng() % ranks[RANK_LIFETIME].size(), RANK_PAGE_SIZE).size();
+	}
+	std::cout << fmt::format("1k random pages:    {:.3f} s\n", since(start));
+
+	delete[] ranks;
+
+	/* Stops the optimiser dropping the lookups */
+	return sum == 0;
+}
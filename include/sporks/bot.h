@@ -138,6 +138,7 @@ public:
 	void onWebhooksUpdate (const dpp::webhooks_update_t &event);
 
 	static std::string GetConfig(const std::string &name);
+	static std::string GetConfig(const std::string &name, const std::string &def);
 
 	static void SetSignal(int signal);
 };
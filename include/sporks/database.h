@@ -26,6 +26,8 @@
 #include <string>
 #include <variant>
 #include <mutex>
+#include <atomic>
+#include <functional>
 #include <dpp/dpp.h>
 #include <mysql/mysql.h>
 
@@ -41,24 +43,33 @@ namespace db {
 	typedef std::vector<std::variant<float, std::string, uint64_t, int64_t, bool, int32_t, uint32_t, double>> paramlist;
 
 
+	/* Completion callback for db::query_async() */
+	typedef std::function<void(const resultset&)> query_callback;
+
+	/* Default number of connections in the foreground pool, if
+	 * not overridden by "dbpoolsize" in the config file.
+	 */
+	const size_t DEFAULT_POOL_SIZE = 10;
+
+	/* Default maximum replication lag (seconds) before a read replica
+	 * is skipped, if not overridden by "dbreplicamaxlag" in the config file.
+	 */
+	const double DEFAULT_MAX_REPLICA_LAG = 5.0;
+
 	/* Represents a MySQL connection.
 
-	 * The system will usually spawn a set of these dictate dby the
-	 * constant POOL_SIZE in database.cpp, plus one extra for background
-	 * queries.
+	 * The system will usually spawn a set of these, the number of which
+	 * is passed to db::connect(), plus one extra for background queries.
 	 * 
-	 * Each separate connections has a mutex which prevents concurrent
+	 * Foreground connections are checked out of the pool exclusively by
+	 * db::query(). Idle connections are kept on a stack protected by a
+	 * mutex, and if none are idle the caller waits on a condition variable
+	 * until one is checked back in. The busy flag is set while a connection
+	 * is checked out (or while the background connection is executing) and
+	 * is only used for reporting.
+	 *
+	 * Each separate connection still has a mutex which prevents concurrent
 	 * calling of that connection (MySQL C api does not support this).
-	 * The busy flag in this stucture is set and cleared independently
-	 * of the mutex being claimed, set to true just before claiming it
-	 * and cleared back to false just after releasing the mutex. This is
-	 * then used to determine if the connection is immediately busy or not.
-	 * Because these connections do not have queues, this is reliable,
-	 * I am aware there is a tiny chance of race condition using a separate
-	 * non-atomic variable like this, but the solution is the simpliest,
-	 * and worst case scenario, if the race is triggered then the code
-	 * just ends up waiting for a query to complete before it can run its
-	 * own. As queries are short lived anyway this is not a big issue.
 	 */
 	struct sqlconn {
 		/* Native MySQL connection struct */
@@ -73,12 +84,14 @@ namespace db {
 		double avg_query_length = 0.0;
 		/* Total time spent waiting fo ror retrieving queries */
 		double busy_time = 0.0;
-		/* True if the connection is currently executing a query.
-		 * If this is set to true attempting to call
-		 * db::real_query() with this connection object will cause
-		 * the mutex to wait for completion.
-		 */
-		bool busy = false;
+		/* True if the connection is currently checked out or executing a query */
+		std::atomic<bool> busy = false;
+		/* MySQL error number of the last query, or 0 if it succeeded */
+		unsigned int last_errno = 0;
+		/* True once mysql_init() has been called on the connection */
+		bool initialised = false;
+		/* True if the last attempt to connect succeeded, and the connection has not been lost since */
+		std::atomic<bool> connected = false;
 	};
 
 	/* Information on a connection for struct statistics */
@@ -97,6 +110,18 @@ namespace db {
 		bool background = false;
 	};
 
+	/* Information on a read replica for struct statistics */
+	struct replica_info {
+		/* Hostname and port */
+		std::string host;
+		/* True if the replica is reachable and replicating */
+		bool healthy = false;
+		/* Replication lag (in seconds) */
+		double lag = 0.0;
+		/* Queries routed to this replica */
+		uint64_t queries = 0;
+	};
+
 	/* Connection information */
 	struct statistics {
 		/* List of connections */
@@ -107,24 +132,119 @@ namespace db {
 		uint64_t queries_errored = 0;
 		/* Background thread queue length */
 		uint64_t bg_queue_length = 0;
+		/* Asynchronous queries waiting for a pool thread */
+		uint64_t async_queue_length = 0;
+		/* Number of connections in the foreground pool */
+		size_t pool_size = 0;
+		/* Number of foreground connections idle right now */
+		size_t pool_idle = 0;
+		/* Total foreground connection checkouts */
+		uint64_t checkouts = 0;
+		/* Checkouts which had to wait for a connection to become idle */
+		uint64_t checkouts_waited = 0;
+		/* Checkout wait time percentiles over recent checkouts (in seconds) */
+		double checkout_wait_p50 = 0.0;
+		double checkout_wait_p95 = 0.0;
+		double checkout_wait_p99 = 0.0;
+		/* Longest checkout wait since startup (in seconds) */
+		double checkout_wait_max = 0.0;
+		/* Read replicas */
+		std::vector<replica_info> replicas;
+		/* Read-only queries which fell back to the primary */
+		uint64_t ro_fallbacks = 0;
+	};
+
+	/* Statistics for one query fingerprint. Queries are fingerprinted by their
+	 * format string with literals replaced by ? and lists of placeholders or
+	 * VALUES rows collapsed to one, so every call of the same query with
+	 * different parameters, or a different number of them, is counted together.
+	 */
+	struct fingerprint_info {
+		/* Query format string */
+		std::string format;
+		/* Times executed (including errors) */
+		uint64_t count = 0;
+		/* Times the query resulted in an error */
+		uint64_t errors = 0;
+		/* Total time spent executing this query (in seconds) */
+		double total_time = 0.0;
+		/* Latency percentiles (in seconds) */
+		double p50 = 0.0;
+		double p95 = 0.0;
+		double p99 = 0.0;
+		/* Rows returned percentiles */
+		uint64_t rows_p50 = 0;
+		uint64_t rows_p95 = 0;
+		uint64_t rows_p99 = 0;
 	};
 
 	/* Get statistics */
 	statistics get_stats();
 
-	/* Connect all connections to the database */
-	bool connect(class dpp::cluster* logger, const std::string &host, const std::string &user, const std::string &pass, const std::string &db, int port);
+	/* Get per-fingerprint statistics, sorted by total time descending */
+	std::vector<fingerprint_info> get_fingerprint_stats();
+
+	/* Write per-fingerprint statistics to a tab separated file, returns false on error */
+	bool dump_fingerprint_stats(const std::string &filename);
+
+	/* Connect all connections to the database, with poolsize foreground connections.
+	 * Replicas are given as "host" or "host:port" and use the same credentials
+	 * and database name as the primary. Replicas lagging more than max_lag
+	 * seconds behind the primary are not used.
+	 */
+	bool connect(class dpp::cluster* logger, const std::string &host, const std::string &user, const std::string &pass, const std::string &db, int port, size_t poolsize = DEFAULT_POOL_SIZE, const std::vector<std::string> &replica_hosts = {}, double max_lag = DEFAULT_MAX_REPLICA_LAG);
 
 	/* Disconnect all connections from from the database */
 	bool close();
 
 	/* Issue a database query and return results.
-	 * The query will be allocated to the first available free connection,
-	 * or if no free connection is available the function will wait for one
-	 * to become availabe (using a mutex).
+	 * The query will be allocated to an idle connection from the pool,
+	 * or if no connection is idle the function will wait for one to be
+	 * returned (using a condition variable).
 	 */
 	resultset query(const std::string &format, const paramlist &parameters);
 
+	/* Issue a read-only query, which may be routed to a read replica.
+	 * Only SELECT and SHOW queries are routed, anything else goes to the
+	 * primary. If no replica is healthy and within the lag limit, or the
+	 * replica connection fails, the query falls back to the primary. Results
+	 * may be up to the lag limit out of date, so don't use this to read back
+	 * something which was just written.
+	 */
+	resultset query_ro(const std::string &format, const paramlist &parameters);
+
+	/* Returns true if the last db::query() or db::query_ro() called by this
+	 * thread failed, to tell an error apart from an empty result. Callbacks
+	 * of asynchronous queries run on the thread which ran the query, so they
+	 * can call this too.
+	 */
+	bool failed();
+
+	/* Issue a query asynchronously and call the callback with the results.
+	 *
+	 * The query is queued and executed by one of the pool threads (there is
+	 * one per foreground connection), so the caller returns immediately.
+	 * The callback is called on that pool thread after the connection has
+	 * been returned to the pool, so it is safe to issue further db::query()
+	 * calls from within it. On error the callback receives an empty resultset,
+	 * exactly as db::query() would return. Anything captured by the callback
+	 * must outlive the query.
+	 *
+	 * The pool threads belong to the bot, not to modules. A module must tag its
+	 * queries with an owner and call db::cancel_async() for it before it is
+	 * unloaded, or a callback may run code which is no longer mapped.
+	 */
+	void query_async(const std::string &format, const paramlist &parameters, query_callback callback, const void* owner = nullptr);
+
+	/* As db::query_async(), but the query is run via db::query_ro() */
+	void query_ro_async(const std::string &format, const paramlist &parameters, query_callback callback, const void* owner = nullptr);
+
+	/* Drop queued asynchronous queries with the given owner without calling their
+	 * callbacks, and wait for any of its queries already running to finish.
+	 * Must not be called from one of that owner's callbacks.
+	 */
+	void cancel_async(const void* owner);
+
 	/* Issue a background query.
 	 *
 	 * When using this function we only care about two things:
@@ -139,4 +259,52 @@ namespace db {
 	 * with its own connection.
 	 */
 	void backgroundquery(const std::string &format, const paramlist &parameters);
+
+	/* A scoped transaction.
+	 *
+	 * Pins one foreground connection from the pool for its lifetime.
+	 * Statements given to add() are escaped and held back, then sent in a
+	 * single round trip by commit(), wrapped in START TRANSACTION and COMMIT
+	 * (the connections are opened with CLIENT_MULTI_STATEMENTS). If any of
+	 * them fails, the whole transaction is rolled back.
+	 *
+	 * query() runs a statement straight away within the transaction, for
+	 * reads the rest of the transaction depends upon (e.g. SELECT ... FOR
+	 * UPDATE). If the object goes out of scope without commit() having been
+	 * called, for example due to an exception, everything is rolled back.
+	 *
+	 * Keep transactions short, the connection is unavailable to the rest of
+	 * the bot until the object is destroyed.
+	 */
+	class transaction {
+		/* Index of the pinned connection in the foreground pool */
+		size_t conn;
+		/* True once START TRANSACTION has been sent */
+		bool started;
+		/* True once committed or rolled back */
+		bool finished;
+		/* True if a statement failed, commit() will roll back instead */
+		bool failed;
+		/* Escaped statements waiting for commit() */
+		std::string batch;
+		/* Format strings of the batched statements, for statistics */
+		std::string formats;
+	public:
+		transaction();
+		~transaction();
+		transaction(const transaction&) = delete;
+		transaction& operator=(const transaction&) = delete;
+
+		/* Run a statement immediately within the transaction and return its results */
+		resultset query(const std::string &format, const paramlist &parameters);
+
+		/* Add a statement to be executed by commit() */
+		void add(const std::string &format, const paramlist &parameters);
+
+		/* Execute all added statements and commit, returns false (having rolled back) on error */
+		bool commit();
+
+		/* Discard all added statements and roll back anything already executed */
+		void rollback();
+	};
 };
@@ -134,6 +134,10 @@ class ModuleLoader {
 	ModMap ModuleList;
 
 	std::string lasterror;
+
+	/* Data left by modules for the next instance of themselves, see SetHandoff() */
+	std::mutex handoff_mtx;
+	std::map<std::string, std::pair<time_t, std::string>> handoff;
 public:
 	/* Module loader mutex */
 	std::mutex mtx;
@@ -171,6 +175,17 @@ public:
 	 */
 	void LoadAll();
 
+	/* Store data for the next instance of a module to pick up with TakeHandoff(), e.g. live state
+	 * saved by a module's destructor during a Reload(). The module's code is unloaded in between,
+	 * so this must be plain serialised data. Replaces any data already stored under the same name.
+	 */
+	void SetHandoff(const std::string &name, const std::string &data);
+
+	/* Retrieve and remove data stored by SetHandoff(). Returns an empty string if there is no data,
+	 * or if it was stored more than max_age seconds ago.
+	 */
+	std::string TakeHandoff(const std::string &name, time_t max_age);
+
 	/* Get a list of all loaded modules */
 	const ModMap& GetModuleList() const;
 
@@ -192,7 +192,11 @@ public:
 						statstr << fmt::format("SQL Statistics\n---------------\n") << "\n";
 						statstr << fmt::format("Total queries executed:  {:10d}", stats.queries_processed) << "\n";
 						statstr << fmt::format("Total queries errored:   {:10d}", stats.queries_errored) << "\n";
-						statstr << fmt::format("Background queue length: {:10d}", stats.bg_queue_length) << "\n\n";
+						statstr << fmt::format("Background queue length: {:10d}", stats.bg_queue_length) << "\n";
+						statstr << fmt::format("Async queue length:      {:10d}", stats.async_queue_length) << "\n";
+						statstr << fmt::format("Pool idle/size:          {:>10s}", fmt::format("{}/{}", stats.pool_idle, stats.pool_size)) << "\n";
+						statstr << fmt::format("Checkouts (waited):      {:10d} ({})", stats.checkouts, stats.checkouts_waited) << "\n";
+						statstr << fmt::format("Checkout wait p50/p95/p99/max (ms): {:.03f}/{:.03f}/{:.03f}/{:.03f}", stats.checkout_wait_p50 * 1000, stats.checkout_wait_p95 * 1000, stats.checkout_wait_p99 * 1000, stats.checkout_wait_max * 1000) << "\n\n";
 						size_t n = 0;
 						statstr << fmt::format("{0:7s} {1:7s}{2:9s}  {3:6s}       {4:s} {5:s}     ", "Conn#", "F/B", "Proc/Err", "Ready", "Avg Query Len", "Total Time") << "\n";
 						statstr << fmt::format("----------------------------------------------------------------\n") << "\n";
@@ -207,8 +211,43 @@ public:
 							ci.busy_time
 							) << "\n";
 						}
+						if (!stats.replicas.empty()) {
+							statstr << "\n" << fmt::format("{0:24s} {1:6s} {2:>8s} {3:>10s}", "Replica", "Up", "Lag (s)", "Queries") << "\n";
+							statstr << fmt::format("----------------------------------------------------------------\n") << "\n";
+							for (db::replica_info& ri : stats.replicas) {
+								statstr << fmt::format("{0:24s} {1:6s} {2:8.01f} {3:10d}", ri.host, ri.healthy ? "🟢" : "🔴", ri.lag, ri.queries) << "\n";
+							}
+							statstr << fmt::format("Read-only fallbacks to primary: {}", stats.ro_fallbacks) << "\n";
+						}
 						bot->core->message_create(dpp::message(msg.channel_id, "```\n" + statstr.str() + "\n```"));
 						bot->sent_messages++;
+					} else if (lowercase(subcommand) == "sqltop") {
+						/* Slowest queries by total time, or "sqltop dump" to write them all to a file */
+						std::string option;
+						tokens >> option;
+						if (lowercase(option) == "dump") {
+							std::string filename = fmt::format("logs/sqltop{:02d}.log", bot->GetClusterID());
+							if (db::dump_fingerprint_stats(filename)) {
+								EmbedSimple("Query statistics written to `" + filename + "`", msg.channel_id);
+							} else {
+								EmbedSimple("Can't write query statistics to `" + filename + "`", msg.channel_id);
+							}
+						} else {
+							std::vector<db::fingerprint_info> fps = db::get_fingerprint_stats();
+							std::ostringstream statstr;
+							statstr << fmt::format("{:>8s} {:>5s} {:>10s} {:>8s} {:>8s} {:>8s} {:>6s}  {:s}", "Count", "Err", "Total ms", "p50 ms", "p95 ms", "p99 ms", "Rows99", "Query") << "\n";
+							size_t n = 0;
+							for (auto& fi : fps) {
+								std::string line = fmt::format("{:8d} {:5d} {:10.01f} {:8.02f} {:8.02f} {:8.02f} {:6d}  {:.40s}", fi.count, fi.errors, fi.total_time * 1000, fi.p50 * 1000, fi.p95 * 1000, fi.p99 * 1000, fi.rows_p99, ReplaceString(fi.format, "\n", " "));
+								/* Stay within discord's message length */
+								if (++n > 15 || statstr.str().length() + line.length() > 1900) {
+									break;
+								}
+								statstr << line << "\n";
+							}
+							bot->core->message_create(dpp::message(msg.channel_id, "```\n" + statstr.str() + "\n```"));
+							bot->sent_messages++;
+						}
 					} else if (lowercase(subcommand) == "sql") {
 						std::string sql;
 						std::getline(tokens, sql);
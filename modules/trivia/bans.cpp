@@ -0,0 +1,103 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <unistd.h>
+#include <fmt/format.h>
+#include <sporks/database.h>
+#include <sporks/stringops.h>
+#include "bans.h"
+#include "trivia.h"
+
+ban_list::ban_list() : banned(std::make_shared<const std::vector<uint64_t>>())
+{
+}
+
+void ban_list::publish(std::vector<uint64_t> &list)
+{
+	std::sort(list.begin(), list.end());
+	list.erase(std::unique(list.begin(), list.end()), list.end());
+	std::atomic_store(&banned, std::shared_ptr<const std::vector<uint64_t>>(std::make_shared<const std::vector<uint64_t>>(std::move(list))));
+}
+
+bool ban_list::is_banned(uint64_t user_id) const
+{
+	std::shared_ptr<const std::vector<uint64_t>> b = std::atomic_load(&banned);
+	return std::binary_search(b->begin(), b->end(), user_id);
+}
+
+void ban_list::reload()
+{
+	db::resultset now = db::query("SELECT NOW(3) AS now", {});
+	db::resultset rs = db::query("SELECT snowflake_id FROM bans WHERE play_ban = 1", {});
+	std::vector<uint64_t> list;
+	list.reserve(rs.size());
+	for (auto& r : rs) {
+		list.push_back(from_string<uint64_t>(r["snowflake_id"], std::dec));
+	}
+	publish(list);
+	if (now.size()) {
+		watermark = now[0]["now"];
+	}
+}
+
+void ban_list::refresh()
+{
+	if (watermark.empty()) {
+		reload();
+		return;
+	}
+	db::resultset changed = db::query("SELECT snowflake_id, play_ban, updated_at FROM bans WHERE updated_at >= '?' - INTERVAL 2 SECOND ORDER BY updated_at", {watermark});
+	db::resultset count = db::query("SELECT COUNT(*) AS c FROM bans WHERE play_ban = 1", {});
+
+	std::shared_ptr<const std::vector<uint64_t>> current = std::atomic_load(&banned);
+	std::vector<uint64_t> list = *current;
+	if (changed.size()) {
+		for (auto& r : changed) {
+			uint64_t user_id = from_string<uint64_t>(r["snowflake_id"], std::dec);
+			list.erase(std::remove(list.begin(), list.end(), user_id), list.end());
+			if (r["play_ban"] == "1") {
+				list.push_back(user_id);
+			}
+		}
+		watermark = std::max(watermark, changed.rbegin()->at("updated_at"));
+		publish(list);
+	}
+	if (count.size() && from_string<size_t>(count[0]["c"], std::dec) != std::atomic_load(&banned)->size()) {
+		reload();
+	}
+}
+
+void TriviaModule::WatchBans()
+{
+	while (!terminating) {
+		for (int i = 0; i < BAN_REFRESH_SECS && !terminating; ++i) {
+			sleep(1);
+		}
+		try {
+			bans->refresh();
+		}
+		catch (std::exception &e) {
+			bot->core->log(dpp::ll_error, fmt::format("Exception in WatchBans: {}", e.what()));
+		}
+	}
+}
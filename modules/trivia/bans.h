@@ -0,0 +1,53 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+/* Players banned from playing. The set is an immutable sorted vector, published by swapping a shared_ptr,
+ * so lookups never take a lock and never see a half built set. Only the watcher thread calls reload()
+ * and refresh().
+ */
+class ban_list
+{
+	std::shared_ptr<const std::vector<uint64_t>> banned;
+	/* updated_at of the newest change read */
+	std::string watermark;
+
+	void publish(std::vector<uint64_t> &list);
+public:
+	ban_list();
+
+	bool is_banned(uint64_t user_id) const;
+
+	/* Load every play ban */
+	void reload();
+
+	/* Apply bans changed since the last load. Rows deleted from bans can't be seen this way, so if the
+	 * number of bans no longer matches, everything is loaded again.
+	 */
+	void refresh();
+};
@@ -0,0 +1,255 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <dpp/dpp.h>
+#include <fmt/format.h>
+#include <sporks/modules.h>
+#include <sporks/database.h>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "checkpoint.h"
+#include "trivia.h"
+
+game_checkpoints::game_checkpoints(const std::string &filename) : map(MAP_FAILED), slots(0)
+{
+	fd = open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd == -1) {
+		throw std::runtime_error(fmt::format("Can't open {}: {}", filename, strerror(errno)));
+	}
+
+	/* Use the existing file if it has a valid header and is the size the header says */
+	struct stat statbuf;
+	checkpoint_header_t header = {};
+	if (fstat(fd, &statbuf) == 0 && statbuf.st_size >= (off_t)sizeof(header) && pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+		header.magic == CHECKPOINT_MAGIC && header.record_size == sizeof(game_checkpoint_t) &&
+		(uint64_t)statbuf.st_size == sizeof(header) + header.slots * sizeof(game_checkpoint_t)) {
+		resize(header.slots);
+	} else {
+		/* Discard anything left in an unusable file before starting a new one */
+		if (ftruncate(fd, 0) != 0) {
+			throw std::runtime_error(fmt::format("Can't truncate {}: {}", filename, strerror(errno)));
+		}
+		resize(CHECKPOINT_INITIAL_SLOTS);
+	}
+
+	for (size_t slot = 0; slot < slots; ++slot) {
+		if (record(slot)->channel_id) {
+			used[record(slot)->channel_id] = slot;
+		} else {
+			free_slots.push_back(slot);
+		}
+	}
+}
+
+game_checkpoints::~game_checkpoints()
+{
+	if (map != MAP_FAILED) {
+		msync(map, sizeof(checkpoint_header_t) + slots * sizeof(game_checkpoint_t), MS_SYNC);
+		munmap(map, sizeof(checkpoint_header_t) + slots * sizeof(game_checkpoint_t));
+	}
+	close(fd);
+}
+
+game_checkpoint_t* game_checkpoints::record(size_t slot)
+{
+	return (game_checkpoint_t*)((char*)map + sizeof(checkpoint_header_t)) + slot;
+}
+
+/* Grow the file to newslots records, which must be at least the current size, and map it again.
+ * New records are zero filled by ftruncate(), so they are free.
+ */
+void game_checkpoints::resize(size_t newslots)
+{
+	size_t length = sizeof(checkpoint_header_t) + newslots * sizeof(game_checkpoint_t);
+	if (map != MAP_FAILED) {
+		munmap(map, sizeof(checkpoint_header_t) + slots * sizeof(game_checkpoint_t));
+		map = MAP_FAILED;
+	}
+	if (ftruncate(fd, length) != 0 || (map = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		throw std::runtime_error(fmt::format("Can't map checkpoint file: {}", strerror(errno)));
+	}
+	checkpoint_header_t* header = (checkpoint_header_t*)map;
+	header->magic = CHECKPOINT_MAGIC;
+	header->record_size = sizeof(game_checkpoint_t);
+	header->slots = newslots;
+	for (size_t slot = slots; slot < newslots && slots; ++slot) {
+		free_slots.push_back(slot);
+	}
+	slots = newslots;
+}
+
+void game_checkpoints::update(const game_checkpoint_t &checkpoint)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto u = used.find(checkpoint.channel_id);
+	size_t slot;
+	if (u != used.end()) {
+		slot = u->second;
+	} else {
+		if (free_slots.empty()) {
+			resize(slots * 2);
+		}
+		slot = free_slots.back();
+		free_slots.pop_back();
+		used[checkpoint.channel_id] = slot;
+	}
+	*record(slot) = checkpoint;
+	dirty.insert(checkpoint.channel_id);
+}
+
+void game_checkpoints::remove(uint64_t channel_id)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto u = used.find(channel_id);
+	if (u != used.end()) {
+		memset(record(u->second), 0, sizeof(game_checkpoint_t));
+		free_slots.push_back(u->second);
+		used.erase(u);
+	}
+	dirty.erase(channel_id);
+}
+
+bool game_checkpoints::find(uint64_t channel_id, game_checkpoint_t &checkpoint)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto u = used.find(channel_id);
+	if (u != used.end()) {
+		checkpoint = *record(u->second);
+		return true;
+	}
+	return false;
+}
+
+void game_checkpoints::retain(const std::unordered_set<uint64_t> &channels)
+{
+	std::vector<uint64_t> stale;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto& u : used) {
+			if (channels.find(u.first) == channels.end()) {
+				stale.push_back(u.first);
+			}
+		}
+	}
+	for (auto channel_id : stale) {
+		remove(channel_id);
+	}
+}
+
+std::vector<game_checkpoint_t> game_checkpoints::take_dirty()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<game_checkpoint_t> changed;
+	changed.reserve(dirty.size());
+	for (auto channel_id : dirty) {
+		changed.push_back(*record(used[channel_id]));
+	}
+	dirty.clear();
+	return changed;
+}
+
+void game_checkpoints::mark_dirty(const std::vector<game_checkpoint_t> &changed)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& c : changed) {
+		if (used.find(c.channel_id) != used.end()) {
+			dirty.insert(c.channel_id);
+		}
+	}
+}
+
+void game_checkpoints::sync()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	msync(map, sizeof(checkpoint_header_t) + slots * sizeof(game_checkpoint_t), MS_ASYNC);
+}
+
+/* Count a question as asked, for the next FlushCheckpoints() */
+void TriviaModule::CountQuestionAsked(uint64_t question_id)
+{
+	std::lock_guard<std::mutex> lock(asked_mutex);
+	asked_questions[question_id]++;
+}
+
+/* Send checkpointed game states and question counters to the database, in one round trip */
+void TriviaModule::FlushCheckpoints()
+{
+	char hostname[1024];
+	hostname[1023] = '\0';
+	gethostname(hostname, 1023);
+
+	std::vector<game_checkpoint_t> changed = checkpoints->take_dirty();
+	std::map<uint64_t, uint32_t> asked;
+	{
+		std::lock_guard<std::mutex> lock(asked_mutex);
+		asked.swap(asked_questions);
+	}
+	if (changed.empty() && asked.empty()) {
+		return;
+	}
+
+	uint32_t cluster_id = bot->GetClusterID();
+	uint32_t total_asked = 0;
+	db::transaction t;
+	for (auto& c : changed) {
+		t.add("UPDATE active_games SET cluster_id = '?', question_index = '?', streak = '?', lastanswered = '?', state = '?' WHERE guild_id = '?' AND channel_id = '?' AND hostname = '?'",
+			{cluster_id, c.question_index, c.streak, c.lastanswered, c.state, c.guild_id, c.channel_id, std::string(hostname)});
+	}
+	for (auto& q : asked) {
+		t.add("UPDATE categories inner join questions on questions.category = categories.id SET questions_asked = questions_asked + ? WHERE questions.id = ?", {q.second, q.first});
+		total_asked += q.second;
+	}
+	if (total_asked) {
+		t.add("UPDATE counters SET asked_15_min = asked_15_min + ?", {total_asked});
+	}
+	if (!t.commit()) {
+		/* Try again on the next flush */
+		bot->core->log(dpp::ll_warning, fmt::format("Failed to store {} game checkpoints in the database", changed.size()));
+		checkpoints->mark_dirty(changed);
+		std::lock_guard<std::mutex> lock(asked_mutex);
+		for (auto& q : asked) {
+			asked_questions[q.first] += q.second;
+		}
+	}
+	checkpoints->sync();
+}
+
+void TriviaModule::WatchCheckpoints()
+{
+	while (!terminating) {
+		for (int i = 0; i < CHECKPOINT_FLUSH_SECS && !terminating; ++i) {
+			sleep(1);
+		}
+		try {
+			FlushCheckpoints();
+		}
+		catch (std::exception &e) {
+			bot->core->log(dpp::ll_error, fmt::format("Exception in WatchCheckpoints: {}", e.what()));
+		}
+	}
+}
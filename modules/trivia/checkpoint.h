@@ -0,0 +1,103 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <cstdint>
+
+#define CHECKPOINT_MAGIC 0x31504b43
+#define CHECKPOINT_INITIAL_SLOTS 256
+
+/* The resume state of one game, as stored in the checkpoint file.
+ * Records are a fixed size so that they can be updated in place.
+ */
+struct game_checkpoint_t
+{
+	uint64_t guild_id;
+	/* Zero if the slot is free */
+	uint64_t channel_id;
+	uint64_t lastanswered;
+	int64_t updated;
+	uint32_t question_index;
+	uint32_t streak;
+	uint32_t state;
+	uint32_t reserved;
+};
+
+struct checkpoint_header_t
+{
+	uint32_t magic;
+	uint32_t record_size;
+	uint64_t slots;
+};
+
+/* A memory mapped file of game checkpoints, one per cluster. Updates are written straight into
+ * the mapping, so the kernel keeps them if the bot crashes, and are also remembered as dirty
+ * so that they can be sent on to the database in batches.
+ */
+class game_checkpoints
+{
+	std::mutex mutex;
+	int fd;
+	void* map;
+	size_t slots;
+	std::unordered_map<uint64_t, size_t> used;
+	std::vector<size_t> free_slots;
+	std::unordered_set<uint64_t> dirty;
+
+	game_checkpoint_t* record(size_t slot);
+	void resize(size_t newslots);
+public:
+	/* Opens or creates the file. An unreadable file is started afresh. Throws std::runtime_error on I/O errors */
+	game_checkpoints(const std::string &filename);
+	~game_checkpoints();
+	game_checkpoints(const game_checkpoints&) = delete;
+	game_checkpoints& operator=(const game_checkpoints&) = delete;
+
+	/* Store the state of a game, replacing any previous state for its channel */
+	void update(const game_checkpoint_t &checkpoint);
+
+	/* Remove a game's state when it ends */
+	void remove(uint64_t channel_id);
+
+	/* Get the state of the game on a channel, returns false if there is none */
+	bool find(uint64_t channel_id, game_checkpoint_t &checkpoint);
+
+	/* Remove all games except those on the given channels */
+	void retain(const std::unordered_set<uint64_t> &channels);
+
+	/* Returns the games changed since the last call */
+	std::vector<game_checkpoint_t> take_dirty();
+
+	/* Mark games returned by take_dirty() as changed again, after they could not be stored.
+	 * Games which have since ended are left out.
+	 */
+	void mark_dirty(const std::vector<game_checkpoint_t> &changed);
+
+	/* Schedule writing of the mapping to disk */
+	void sync();
+};
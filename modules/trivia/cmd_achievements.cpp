@@ -41,7 +41,7 @@ using json = nlohmann::json;
 
 command_achievements_t::command_achievements_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-void command_achievements_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_achievements_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	dpp::snowflake user_id = 0;
 	tokens >> user_id;
@@ -49,17 +49,18 @@ void command_achievements_t::call(const in_cmd &cmd, std::stringstream &tokens,
 		user_id = cmd.author_id;
 	}
 
-	uint32_t unlock_count = from_string<uint32_t>(db::query("SELECT COUNT(*) AS unlocked FROM achievements WHERE user_id = ?", {user_id})[0]["unlocked"], std::dec);
+	user_card_t card = creator->cards->get(user_id);
+	uint32_t unlock_count = card.achievements.size();
 	std::string trophies = fmt::format(_("ACHCOUNT", settings), unlock_count, creator->achievements->size() - unlock_count) + "\n";
 
 	std::vector<field_t> fields;
 
 	for (auto& showoff : *(creator->achievements)) {
-		db::resultset inf = db::query("SELECT *, date_format(unlocked, '%d-%b-%Y') AS unlocked_friendly FROM achievements WHERE user_id = ? AND achievement_id = ?", {user_id, showoff["id"].get<uint32_t>()});
-		if (inf.size()) {
+		auto inf = card.achievements.find(showoff["id"].get<uint32_t>());
+		if (inf != card.achievements.end()) {
 			fields.push_back({
 				"<:" + showoff["image"].get<std::string>() + ":" + showoff["emoji_unlocked"].get<std::string>() + "> - " + _(showoff["name"].get<std::string>(), settings),
-				_(showoff["desc"].get<std::string>(), settings) + " (*" + inf[0]["unlocked_friendly"] + "*)\n" + BLANK_EMOJI,
+				_(showoff["desc"].get<std::string>(), settings) + " (*" + inf->second + "*)\n" + BLANK_EMOJI,
 				false
 			});
 		}
@@ -38,7 +38,7 @@
 
 command_categories_t::command_categories_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-void command_categories_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_categories_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	uint32_t page = 0;
 	std::string namefield = "name";
@@ -50,35 +50,37 @@ void command_categories_t::call(const in_cmd &cmd, std::stringstream &tokens, gu
 	}
 
 	desc = fmt::format("{} {:9s}  {}\n-----------------------------------------\n", "Enabled", "Questions", "Name");
-	db::resultset counter = db::query("SELECT id FROM categories WHERE disabled != 1", {});
-	size_t rows = counter.size();
-	uint32_t start_record = (page - 1) * 25;
-	uint32_t length = 25;
-	uint32_t pages = ceil((float)rows / (float)length);
-	db::resultset q = db::query("SELECT categories.*, (SELECT COUNT(*) FROM questions WHERE questions.category = categories.id) AS total, IF(guild_id IS NULL, 0, 1) AS local_disabled FROM categories LEFT JOIN disabled_categories ON categories.id = disabled_categories.category_id AND guild_id = '?' WHERE disabled != 1 AND name != 'Server' ORDER BY categories.name LIMIT ?, ?", {cmd.guild_id, start_record, length});
+	/* Page is built on a db pool thread once the category count is known */
+	db::query_ro_async("SELECT id FROM categories WHERE disabled != 1", {}, [this, cmd, settings, page, namefield, desc](const db::resultset &counter) mutable {
+		size_t rows = counter.size();
+		uint32_t start_record = (page - 1) * 25;
+		uint32_t length = 25;
+		uint32_t pages = ceil((float)rows / (float)length);
+		db::resultset q = db::query_ro("SELECT categories.*, (SELECT COUNT(*) FROM questions WHERE questions.category = categories.id) AS total, IF(guild_id IS NULL, 0, 1) AS local_disabled FROM categories LEFT JOIN disabled_categories ON categories.id = disabled_categories.category_id AND guild_id = '?' WHERE disabled != 1 AND name != 'Server' ORDER BY categories.name LIMIT ?, ?", {cmd.guild_id, start_record, length});
 
-	if (settings.language != "en") {
-		namefield = "trans_" + settings.language;
-	}
+		if (settings.language != "en") {
+			namefield = "trans_" + settings.language;
+		}
 
-	std::deque<db::row> deq;
-	deq.resize(q.size());
-	copy(q.begin(), q.end(), deq.begin());
+		std::deque<db::row> deq;
+		deq.resize(q.size());
+		copy(q.begin(), q.end(), deq.begin());
 
-	if (settings.premium) {
-		deq.push_front({
-			{namefield, "Server (⭐ Premium ⭐)"},
-			{"local_disabled", "0"},
-			{"total", db::query("SELECT COUNT(id) AS qc FROM questions WHERE guild_id = ?", {cmd.guild_id})[0]["qc"]}
-		});
-	}
+		if (settings.premium) {
+			deq.push_front({
+				{namefield, "Server (⭐ Premium ⭐)"},
+				{"local_disabled", "0"},
+				{"total", db::query_ro("SELECT COUNT(id) AS qc FROM questions WHERE guild_id = ?", {cmd.guild_id})[0]["qc"]}
+			});
+		}
 
-	for (auto & cat : deq) {
-		desc += fmt::format("{} {:9s}  {}\n", cat["local_disabled"] == "0" ? "🟢    " : "🔴    ", cat["total"], cat[namefield]);
-	}
+		for (auto & cat : deq) {
+			desc += fmt::format("{} {:9s}  {}\n", cat["local_disabled"] == "0" ? "🟢    " : "🔴    ", cat["total"], cat[namefield]);
+		}
 
-	desc += "\n" + fmt::format(_("PAGES", settings), page, pages) + "\n";
+		desc += "\n" + fmt::format(_("PAGES", settings), page, pages) + "\n";
 
-	creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, "", "```\n" + desc + "\n```\n" + _("CATHINT", settings), cmd.channel_id, _("CATLIST", settings));
+		creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, "", "```\n" + desc + "\n```\n" + _("CATHINT", settings), cmd.channel_id, _("CATLIST", settings));
+	}, creator);
 	creator->CacheUser(cmd.author_id, cmd.user, cmd.member, cmd.channel_id);
 }
@@ -38,7 +38,7 @@
 
 command_coins_t::command_coins_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-void command_coins_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_coins_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	dpp::snowflake user_id = 0;
 	tokens >> user_id;
@@ -47,10 +47,7 @@ void command_coins_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_s
 		user_id = cmd.author_id;
 	}
 
-	db::resultset coins = db::query("SELECT * FROM coins WHERE user_id = '?'", {user_id});
-	if (coins.size()) {
-        	balance = from_string<uint64_t>(coins[0]["balance"], std::dec);
-	}
+	balance = creator->coins->balance(user_id);
 
 	std::string body = fmt::format(_("COINTOTAL", settings), balance) + "\n\n[" + _("SHOPURLTEXT", settings) + "](https://triviabot.co.uk/coinshop/)";
 	creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, "", body, cmd.channel_id, _("YOURWALLET", settings), "", "https://triviabot.co.uk/images/coin.gif");
@@ -122,12 +122,12 @@ command_context_user_t::command_context_user_t(class TriviaModule* _creator, con
 {
 }
 
-void command_context_message_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_context_message_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	command_context_user_t::call(cmd, tokens, settings, username, is_moderator, c, user);
 }
 
-void command_context_user_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_context_user_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	creator->CacheUser(cmd.author_id, cmd.user, cmd.member, cmd.channel_id);
 
@@ -195,7 +195,7 @@ void command_context_user_t::call(const in_cmd &cmd, std::stringstream &tokens,
 	save_active_menu(cmd.user.id, {0, real_interaction_token, {}, 1, round_type, time(nullptr), 0});
 }
 
-void RefreshMessage(in_flight &infl, guild_settings_t& settings, std::string base_command, TriviaModule* creator)
+void RefreshMessage(in_flight &infl, const guild_settings_t& settings, std::string base_command, TriviaModule* creator)
 {
 	std::string field = (settings.language == "en") ? "name" : "trans_" + settings.language;
 	dpp::message msg;
@@ -269,7 +269,7 @@ void RefreshMessage(in_flight &infl, guild_settings_t& settings, std::string bas
 	);
 }
 
-void command_context_user_t::button_click(const dpp::button_click_t & event, const in_cmd &cmd, guild_settings_t &settings)
+void command_context_user_t::button_click(const dpp::button_click_t & event, const in_cmd &cmd, const guild_settings_t &settings)
 {
 	std::string message;
 	event.reply();
@@ -327,7 +327,7 @@ void command_context_user_t::button_click(const dpp::button_click_t & event, con
 }
 
 
-void command_context_user_t::select_click(const dpp::select_click_t & event, const in_cmd &cmd, guild_settings_t &settings)
+void command_context_user_t::select_click(const dpp::select_click_t & event, const in_cmd &cmd, const guild_settings_t &settings)
 {
 	event.reply();
 	auto i = find_active_menu(event.command.usr.id);
@@ -38,7 +38,7 @@
 
 command_create_t::command_create_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-void command_create_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_create_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	std::string newteamname;
 	std::getline(tokens, newteamname);
@@ -53,11 +53,18 @@ void command_create_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_
 			if (!cc.clean) {
 				cleaned_team_name = cc.censored_content;
 			}
-			auto rs = db::query("SELECT * FROM teams WHERE name = '?'", {cleaned_team_name});
+			/* Team creation and joining it are committed together, or not at all */
+			db::transaction t;
+			auto rs = t.query("SELECT * FROM teams WHERE name = '?' FOR UPDATE", {cleaned_team_name});
 			if (rs.empty()) {
-				db::query("INSERT INTO teams (name, score) VALUES('?', 0)", {cleaned_team_name});
+				t.query("INSERT INTO teams (name, score) VALUES('?', 0)", {cleaned_team_name});
 				try {
-					join_team(cmd.author_id, cleaned_team_name, cmd.channel_id);
+					if (!join_team(cmd.author_id, cleaned_team_name, cmd.channel_id, t) || !t.commit()) {
+						creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, ":warning:", fmt::format(_("CANTCREATE", settings), username), cmd.channel_id);
+						return;
+					}
+					creator->teams->created(cleaned_team_name);
+					creator->teams->joined(cmd.author_id, cleaned_team_name);
 				}
 				catch (const JoinNotQualifiedException& e) {
 					creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, ":warning:", fmt::format(_("CANTCREATE", settings), username), cmd.channel_id);
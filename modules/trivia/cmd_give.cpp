@@ -38,11 +38,10 @@
 
 command_give_t::command_give_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-void command_give_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_give_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	dpp::snowflake user_id = 0;
 	int64_t howmuch = 0;
-	uint64_t balance = 0;
 	std::string message;
 
 	tokens >> user_id >> howmuch;
@@ -54,16 +53,11 @@ void command_give_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_se
 		user_id = cmd.author_id;
 	}
 
-	db::resultset coins = db::query("SELECT * FROM coins WHERE user_id = '?'", {cmd.author_id});
-	if (coins.size()) {
-        	balance = from_string<uint64_t>(coins[0]["balance"], std::dec);
-	}
-
-	if (howmuch > balance) {
-		message = _("NOTENOUGH", settings);
-	} else {
+	/* The balance check and transfer are one step, so two gives can't both spend the same coins */
+	if (creator->coins->give(cmd.author_id, user_id, howmuch)) {
 		message = fmt::format(_("GAVECOINS", settings), howmuch, user_id);
-		db::backgroundquery("CALL give_coins(?, ?, ?)", {howmuch, cmd.author_id, user_id});
+	} else {
+		message = _("NOTENOUGH", settings);
 	}
 
 	creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, "", message + "\n\n[" + _("SHOPURLTEXT", settings) + "](https://triviabot.co.uk/coinshop/)",
@@ -26,6 +26,7 @@
 #include <sporks/regex.h>
 #include <string>
 #include <cstdint>
+#include <cmath>
 #include <fstream>
 #include <streambuf>
 #include <sporks/stringops.h>
@@ -38,9 +39,41 @@
 
 command_global_t::command_global_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-void command_global_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_global_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
-	creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, ":white_check_mark:", _("LEADERBOARDLINK", settings), cmd.channel_id);
+	uint32_t page = 0;
+	tokens >> page;
+	if (!page) {
+		page = 1;
+	}
+
+	std::vector<rank_entry_t> entries = creator->ranks->page(page, RANK_LIFETIME);
+	if (!creator->ranks->ready() || entries.empty()) {
+		/* Rank index is still loading, or the page is past the end */
+		creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, ":white_check_mark:", _("LEADERBOARDLINK", settings), cmd.channel_id);
+		creator->CacheUser(cmd.author_id, cmd.user, cmd.member, cmd.channel_id);
+		return;
+	}
+	uint32_t pages = ceil((float)creator->ranks->size(RANK_LIFETIME) / (float)RANK_PAGE_SIZE);
+
+	std::vector<uint64_t> ids;
+	for (auto& e : entries) {
+		ids.push_back(e.user_id);
+	}
+	std::unordered_map<uint64_t, user_card_t> names = creator->cards->get(ids);
+
+	std::string desc;
+	for (auto& e : entries) {
+		user_card_t& card = names[e.user_id];
+		if (card.found) {
+			desc += fmt::format("**#{}** `{}#{:04d}` (*{}*) {}\n", e.rank, card.username, card.discriminator, e.score, card.emojis);
+		} else {
+			desc += fmt::format("**#{}** <@{}> (*{}*)\n", e.rank, e.user_id, e.score);
+		}
+	}
+	desc += "\n" + fmt::format(_("PAGES", settings), page, pages) + "\n\n" + _("LEADERBOARDLINK", settings);
+
+	creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, "", desc, cmd.channel_id, _("LEADERBOARD", settings));
 	creator->CacheUser(cmd.author_id, cmd.user, cmd.member, cmd.channel_id);
 }
 
@@ -38,7 +38,7 @@
 
 command_invite_t::command_invite_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-void command_invite_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_invite_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, "🎉", _("INVITEBLURB", settings), cmd.channel_id, _("INVITEME", settings), "", "https://triviabot.co.uk/images/triviabot_tl_icon.png");
 	creator->CacheUser(cmd.author_id, cmd.user, cmd.member, cmd.channel_id);
@@ -40,7 +40,7 @@ using json = nlohmann::json;
 
 command_language_t::command_language_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-void command_language_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_language_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	std::string lang_name;
 	std::string namefield = "name";
@@ -73,9 +73,11 @@ void command_language_t::call(const in_cmd &cmd, std::stringstream &tokens, guil
 	if (r.size() == 0) {
 		creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, ":warning:", _("BADLANG", settings), cmd.channel_id);
 	} else {
-		settings.language = lang_name;
+		guild_settings_t newsettings = settings;
+		newsettings.language = lang_name;
 		db::backgroundquery("UPDATE bot_guild_settings SET language = '?' WHERE snowflake_id = '?'", {lang_name, cmd.guild_id});
-		creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, ":white_check_mark:", _("LANGCHANGE", settings), cmd.channel_id, _("CATDONE", settings));
+		creator->UpdateGuildSettings(cmd.guild_id, [lang_name](guild_settings_t &s) { s.language = lang_name; });
+		creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, newsettings, ":white_check_mark:", _("LANGCHANGE", newsettings), cmd.channel_id, _("CATDONE", newsettings));
 	}
 
 }
@@ -37,12 +37,12 @@
 
 command_nitro_t::command_nitro_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-void command_nitro_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_nitro_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	std::string desc;
 	uint8_t rank = 1;
 
-	db::resultset q = db::query("SELECT global_scores.*, trivia_user_cache.*, emojis FROM global_scores INNER JOIN trivia_user_cache ON snowflake_id = name LEFT JOIN trivia_access ON name = trivia_access.user_id LEFT JOIN vw_emojis ON vw_emojis.user_id = snowflake_id WHERE (trivia_access.id is null OR trivia_access.enabled = 0) AND (SELECT COUNT(*) FROM bans WHERE nitro_ban = 1 AND bans.snowflake_id = trivia_user_cache.snowflake_id) = 0 AND (SELECT COUNT(*) FROM inventory WHERE shop_id = 37 AND user_id = trivia_user_cache.snowflake_id) = 0 ORDER BY monthscore DESC, trivia_user_cache.snowflake_id LIMIT 10", {});
+	db::resultset q = db::query_ro("SELECT global_scores.*, trivia_user_cache.*, emojis FROM global_scores INNER JOIN trivia_user_cache ON snowflake_id = name LEFT JOIN trivia_access ON name = trivia_access.user_id LEFT JOIN vw_emojis ON vw_emojis.user_id = snowflake_id WHERE (trivia_access.id is null OR trivia_access.enabled = 0) AND (SELECT COUNT(*) FROM bans WHERE nitro_ban = 1 AND bans.snowflake_id = trivia_user_cache.snowflake_id) = 0 AND (SELECT COUNT(*) FROM inventory WHERE shop_id = 37 AND user_id = trivia_user_cache.snowflake_id) = 0 ORDER BY monthscore DESC, trivia_user_cache.snowflake_id LIMIT 10", {});
 	for (auto & user : q) {
 		desc += "**#" + std::to_string(rank) + "** `" + user["username"] + "#" + fmt::format("{:04d}", from_string<int>(user["discriminator"], std::dec)) + "` (*" + user["monthscore"] + "*) " + user["emojis"];
 		if (rank++ == 1) {
@@ -40,7 +40,7 @@ using json = nlohmann::json;
 
 command_prefix_t::command_prefix_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-void command_prefix_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_prefix_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	std::string prefix;
 	std::getline(tokens, prefix);
@@ -53,6 +53,7 @@ void command_prefix_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_
 
 	if (!prefix.empty()) {
 		db::backgroundquery("UPDATE bot_guild_settings SET prefix = '?' WHERE snowflake_id = '?'", {prefix, cmd.guild_id});
+		creator->UpdateGuildSettings(cmd.guild_id, [prefix](guild_settings_t &s) { s.prefix = prefix; });
 		creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, ":white_check_mark:", fmt::format(_("PREFIXSET", settings), prefix), cmd.channel_id);
 	}
 	creator->CacheUser(cmd.author_id, cmd.user, cmd.member, cmd.channel_id);
@@ -41,7 +41,7 @@ using json = nlohmann::json;
 
 command_profile_t::command_profile_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-void command_profile_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_profile_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	dpp::snowflake user_id = 0;
 	tokens >> user_id;
@@ -49,52 +49,67 @@ void command_profile_t::call(const in_cmd &cmd, std::stringstream &tokens, guild
 		user_id = cmd.author_id;
 	}
 
-	db::resultset _user = db::query("SELECT *, get_all_emojis(snowflake_id) as emojis FROM trivia_user_cache WHERE snowflake_id = '?'", {user_id});
-	if (_user.size()) {
-		std::string a;
-		for (auto& ach : *(creator->achievements)) {
-			db::resultset inf = db::query("SELECT *, date_format(unlocked, '%d-%b-%Y') AS unlocked_friendly FROM achievements WHERE user_id = ? AND achievement_id = ?", {user_id, ach["id"].get<uint32_t>()});
-			if (inf.size()) {
-				a += "<:" + ach["image"].get<std::string>() + ":" + ach["emoji_unlocked"].get<std::string>() + ">";
+	/* Profile is built on a db pool thread once the user cache row arrives */
+	db::query_ro_async("SELECT *, get_all_emojis(snowflake_id) as emojis FROM trivia_user_cache WHERE snowflake_id = '?'", {user_id}, [this, cmd, settings, user_id](db::resultset _user) {
+		if (_user.size()) {
+			std::string a;
+			user_card_t card = creator->cards->get(user_id);
+			for (auto& ach : *(creator->achievements)) {
+				if (card.achievements.find(ach["id"].get<uint32_t>()) != card.achievements.end()) {
+					a += "<:" + ach["image"].get<std::string>() + ":" + ach["emoji_unlocked"].get<std::string>() + ">";
+				}
 			}
-		}
-
-		db::resultset srs = db::query("SELECT * FROM global_scores WHERE name = '?'", {user_id});
-		uint64_t lifetime = 0;
-		uint64_t weekly = 0;
-		uint64_t daily = 0;
-		uint64_t monthly = 0;
-		if (srs.size()) {
-			lifetime = from_string<uint64_t>(srs[0]["score"], std::dec);
-			weekly = from_string<uint64_t>(srs[0]["weekscore"], std::dec);
-			daily = from_string<uint64_t>(srs[0]["dayscore"], std::dec);
-			monthly = from_string<uint64_t>(srs[0]["monthscore"], std::dec);
-		}
-		std::string dl = fmt::format("{:32s}{:8d}", _("DAILY", settings), daily);
-		std::string wl = fmt::format("{:32s}{:8d}", _("WEEKLY", settings), weekly);
-		std::string ml = fmt::format("{:32s}{:8d}", _("MONTHLY", settings), monthly);
-		std::string ll = fmt::format("{:32s}{:8d}", _("LIFETIME", settings), lifetime);
 
-		std::string scores = "```" + dl + "\n" + wl + "\n" + ml + "\n" + ll + "```";
+			uint64_t lifetime = 0;
+			uint64_t weekly = 0;
+			uint64_t daily = 0;
+			uint64_t monthly = 0;
+			uint64_t rank = 0;
+			if (creator->ranks->ready()) {
+				lifetime = creator->ranks->get_score(user_id, RANK_LIFETIME);
+				weekly = creator->ranks->get_score(user_id, RANK_WEEK);
+				daily = creator->ranks->get_score(user_id, RANK_DAY);
+				monthly = creator->ranks->get_score(user_id, RANK_MONTH);
+				rank = creator->ranks->rank(user_id, RANK_LIFETIME);
+			} else {
+				/* Rank index is still loading */
+				db::resultset srs = db::query_ro("SELECT * FROM global_scores WHERE name = '?'", {user_id});
+				if (srs.size()) {
+					lifetime = from_string<uint64_t>(srs[0]["score"], std::dec);
+					weekly = from_string<uint64_t>(srs[0]["weekscore"], std::dec);
+					daily = from_string<uint64_t>(srs[0]["dayscore"], std::dec);
+					monthly = from_string<uint64_t>(srs[0]["monthscore"], std::dec);
+				}
+			}
+			std::string dl = fmt::format("{:32s}{:8d}", _("DAILY", settings), daily);
+			std::string wl = fmt::format("{:32s}{:8d}", _("WEEKLY", settings), weekly);
+			std::string ml = fmt::format("{:32s}{:8d}", _("MONTHLY", settings), monthly);
+			std::string ll = fmt::format("{:32s}{:8d}", _("LIFETIME", settings), lifetime);
 
-		a += BLANK_EMOJI;
-		std::string emojis = _user[0]["emojis"] + BLANK_EMOJI;
+			std::string scores = "```" + dl + "\n" + wl + "\n" + ml + "\n" + ll;
+			if (rank) {
+				scores += "\n" + fmt::format("{:32s}{:8d}", _("GLOBALRANK", settings), rank);
+			}
+			scores += "```";
 
-		creator->EmbedWithFields(
-			cmd.interaction_token, cmd.command_id, settings,
-			fmt::format("{0}#{1:04d} {2}", _user[0]["username"], from_string<uint32_t>(_user[0]["discriminator"], std::dec), _("PROFILETITLE", settings)),
-			{
-				{ _("BADGES", settings), emojis, true },
-				{ _("ACHIEVEMENTS", settings), a, true },
-				{ BLANK_EMOJI, scores, false }
-			}, cmd.channel_id, "https://triviabot.co.uk/profile" + std::to_string(user_id), "",
-			"https://triviabot.co.uk/images/busts.png",
-			"[" + _("CLICKHEREPROFILE", settings) + "](https://triviabot.co.uk/profile/" + std::to_string(user_id) + ")"
-		);
+			a += BLANK_EMOJI;
+			std::string emojis = _user[0]["emojis"] + BLANK_EMOJI;
 
-		creator->CacheUser(cmd.author_id, cmd.user, cmd.member, cmd.channel_id);
-	} else {
-		creator->GetBot()->core->log(dpp::ll_warning, fmt::format("profile: No such user: {}", user_id));
-	}
+			creator->EmbedWithFields(
+				cmd.interaction_token, cmd.command_id, settings,
+				fmt::format("{0}#{1:04d} {2}", _user[0]["username"], from_string<uint32_t>(_user[0]["discriminator"], std::dec), _("PROFILETITLE", settings)),
+				{
+					{ _("BADGES", settings), emojis, true },
+					{ _("ACHIEVEMENTS", settings), a, true },
+					{ BLANK_EMOJI, scores, false }
+				}, cmd.channel_id, "https://triviabot.co.uk/profile" + std::to_string(user_id), "",
+				"https://triviabot.co.uk/images/busts.png",
+				"[" + _("CLICKHEREPROFILE", settings) + "](https://triviabot.co.uk/profile/" + std::to_string(user_id) + ")"
+			);
 
+			creator->CacheUser(cmd.author_id, cmd.user, cmd.member, cmd.channel_id);
+		} else {
+			creator->GetBot()->core->log(dpp::ll_warning, fmt::format("profile: No such user: {}", user_id));
+		}
+	}, creator);
 }
@@ -40,7 +40,7 @@ using json = nlohmann::json;
 
 command_resetprefix_t::command_resetprefix_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-void command_resetprefix_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_resetprefix_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	dpp::snowflake guild_id;
 	tokens >> guild_id;
@@ -49,6 +49,7 @@ void command_resetprefix_t::call(const in_cmd &cmd, std::stringstream &tokens, g
 
 	if (access.size() && guild_id) {
 		db::backgroundquery("UPDATE bot_guild_settings SET prefix = '!' WHERE snowflake_id = '?'", {guild_id});
+		creator->UpdateGuildSettings(guild_id, [](guild_settings_t &s) { s.prefix = "!"; });
 		creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, ":white_check_mark:", fmt::format("Prefix on guild `{}` has been reset to `!`", guild_id), cmd.channel_id);
 	} else {
 		creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, ":warning:", "This command is for the TriviaBot team only", cmd.channel_id);
@@ -37,10 +37,10 @@
 
 command_servertime_t::command_servertime_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-void command_servertime_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_servertime_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	time_t now_time = time(nullptr);
-	time_t seconds_until_reset = 86400 - (now_time % 86400);
+	time_t seconds_until_reset = period_end(LB_DAY, now_time) - now_time;
 	time_t reset_time = now_time + seconds_until_reset;
 	std::string sf = fmt::format("{:02d}:{:02d}:{:02d}", seconds_until_reset / 60 / 60 % 24, seconds_until_reset / 60 % 60, seconds_until_reset % 60);
 
@@ -40,17 +40,7 @@ using json = nlohmann::json;
 
 command_start_t::command_start_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-std::vector<uint64_t> GetChannelWhitelist(uint64_t guild_id)
-{
-	std::vector<uint64_t> wl;
-	db::resultset rs = db::query("SELECT channel_id FROM channel_whitelist WHERE guild_id = '?'", {guild_id});
-	for (auto row : rs) {
-		wl.push_back(from_string<uint64_t>(row["channel_id"], std::dec));
-	}
-	return wl;
-}
-
-void command_start_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_start_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	int32_t questions;
 	std::string str_q;
@@ -60,8 +50,7 @@ void command_start_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_s
 	tokens >> str_q;
 
 	/* Don't allow banned users to start games at all */
-	db::resultset rs2 = db::query("SELECT snowflake_id FROM bans WHERE play_ban = 1 AND snowflake_id = ?", {cmd.author_id});
-	if (rs2.size()) {
+	if (creator->bans->is_banned(cmd.author_id)) {
 		return;
 	}
 
@@ -88,16 +77,9 @@ void command_start_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_s
 	bool quickfire = (base_command == "quickfire" || base_command == "qf");
 	bool hintless = (base_command == "hardcore" || base_command == "hc");
 
-	json document;
-	std::ifstream configfile("../config.json");
-	json shitlist = document["shitlist"];
-	configfile >> document;
-	for (auto entry = shitlist.begin(); entry != shitlist.end(); ++entry) {
-		int64_t sl_guild_id = from_string<int64_t>(entry->get<std::string>(), std::dec);
-		if (cmd.channel_id == sl_guild_id) {
-			creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, ":warning:", fmt::format(_("SHITLISTED", settings), username, creator->GetBot()->user.id), cmd.channel_id);
-			return;
-		}
+	if (creator->gate->blocked(cmd.guild_id) || creator->gate->blocked(cmd.channel_id)) {
+		creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, ":warning:", fmt::format(_("SHITLISTED", settings), username, creator->GetBot()->user.id), cmd.channel_id);
+		return;
 	}
 
 	if (!cmd.from_dashboard && settings.only_mods_start) {
@@ -107,7 +89,7 @@ void command_start_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_s
 		}
 	}
 
-	std::vector<uint64_t> whitelist = GetChannelWhitelist(cmd.guild_id);
+	std::vector<uint64_t> whitelist = creator->gate->whitelist(cmd.guild_id);
 	std::string whitelist_str;
 	bool allowed = true;
 	if (!cmd.from_dashboard && whitelist.size()) {
@@ -231,18 +213,13 @@ void command_start_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_s
 		} else  {
 
 			if (quickfire && !settings.premium) {
-				db::resultset lastinsane = db::query("SELECT * FROM insane_cooldown WHERE guild_id = ?", {cmd.guild_id});
-				if (lastinsane.size()) {
-					time_t last_insane_time = from_string<time_t>(lastinsane[0]["last_started"], std::dec);
-					if (time(NULL) - last_insane_time < 900) {
-						int64_t seconds = 900 - (time(NULL) - last_insane_time);
-						int64_t minutes = floor((float)seconds / 60.0f);
-						seconds = seconds % 60;
-						creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, ":warning:", fmt::format(_("INSANE_COOLDOWN", settings), minutes, seconds), cmd.channel_id);
-						return;
-					}
+				time_t seconds = creator->gate->claim_cooldown(cmd.guild_id, INSANE_COOLDOWN);
+				if (seconds) {
+					int64_t minutes = seconds / 60;
+					seconds = seconds % 60;
+					creator->SimpleEmbed(cmd.interaction_token, cmd.command_id, settings, ":warning:", fmt::format(_("INSANE_COOLDOWN", settings), minutes, seconds), cmd.channel_id);
+					return;
 				}
-				db::backgroundquery("INSERT INTO insane_cooldown (guild_id, last_started) VALUES(?, UNIX_TIMESTAMP()) ON DUPLICATE KEY UPDATE last_started = UNIX_TIMESTAMP()", {cmd.guild_id});
 			}
 
 			check_create_webhook(settings, creator, cmd.channel_id);
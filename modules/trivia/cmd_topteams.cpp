@@ -36,12 +36,12 @@
 
 command_topteams_t::command_topteams_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options) : command_t(_creator, _base_command, adm, descr, options) { }
 
-void command_topteams_t::call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
+void command_topteams_t::call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user)
 {
 	std::string desc;
 	uint8_t rank = 1;
 
-	db::resultset q = db::query("SELECT * FROM teams ORDER BY score DESC LIMIT 10", {});
+	db::resultset q = db::query_ro("SELECT * FROM teams ORDER BY score DESC LIMIT 10", {});
 	for (auto & team : q) {
 		desc += "**#" + std::to_string(rank) + "** `" + team["name"] + "` (*" + team["score"] + "*)";
 		if (rank++ == 1) {
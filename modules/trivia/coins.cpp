@@ -0,0 +1,309 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <dpp/dpp.h>
+#include <fmt/format.h>
+#include <sporks/modules.h>
+#include <sporks/database.h>
+#include <sporks/stringops.h>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include "coins.h"
+#include "trivia.h"
+
+coin_ledger::coin_ledger(const std::string &_filename, uint32_t _cluster_id) : filename(_filename), cluster_id(_cluster_id), next_seq(1), epoch(0), written(0), synced(0)
+{
+	/* Changes up to last_seq reached the database, even if they were not removed from the log afterwards */
+	db::resultset rs = db::query("SELECT last_seq FROM coin_ledger_state WHERE cluster_id = ?", {cluster_id});
+	uint64_t last_seq = rs.size() ? from_string<uint64_t>(rs[0]["last_seq"], std::dec) : 0;
+	next_seq = last_seq + 1;
+
+	/* Any others left from a previous run were never confirmed as written, so replay them */
+	std::ifstream log(filename);
+	std::string type;
+	coin_op_t op;
+	while (log >> op.seq >> type >> op.from >> op.to >> op.amount) {
+		next_seq = std::max(next_seq, op.seq + 1);
+		if (type == "mark" || op.seq <= last_seq) {
+			continue;
+		}
+		op.type = (type == "give" ? COIN_GIVE : COIN_DROP);
+		journal.push_back(op);
+		if (op.type == COIN_GIVE) {
+			accounts[op.from].pending -= op.amount;
+		}
+		accounts[op.to].pending += op.amount;
+	}
+	written = synced = next_seq - 1;
+	fd = open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+	if (fd == -1) {
+		throw std::runtime_error(fmt::format("Can't open {}: {}", filename, strerror(errno)));
+	}
+}
+
+coin_ledger::~coin_ledger()
+{
+	close(fd);
+}
+
+void coin_ledger::append(const coin_op_t &op)
+{
+	std::string line = fmt::format("{} {} {} {} {}\n", op.seq, op.type == COIN_GIVE ? "give" : "drop", op.from, op.to, op.amount);
+	if (write(fd, line.data(), line.length()) != (ssize_t)line.length()) {
+		throw std::runtime_error(fmt::format("Can't write {}: {}", filename, strerror(errno)));
+	}
+	written = op.seq;
+}
+
+void coin_ledger::sync(uint64_t seq)
+{
+	std::lock_guard<std::mutex> lock(sync_mutex);
+	if (synced >= seq) {
+		/* Synced by another caller while this one waited */
+		return;
+	}
+	uint64_t upto = written;
+	if (fdatasync(fd) != 0) {
+		throw std::runtime_error(fmt::format("Can't write {}: {}", filename, strerror(errno)));
+	}
+	synced = upto;
+}
+
+void coin_ledger::rewrite()
+{
+	/* The sequence number is kept even when nothing is left, so that it never goes back to one already written */
+	std::string content = fmt::format("{} mark 0 0 0\n", next_seq - 1);
+	for (auto& op : journal) {
+		content += fmt::format("{} {} {} {} {}\n", op.seq, op.type == COIN_GIVE ? "give" : "drop", op.from, op.to, op.amount);
+	}
+	std::string tmp = filename + ".tmp";
+	int newfd = open(tmp.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (newfd == -1 || write(newfd, content.data(), content.length()) != (ssize_t)content.length() || fdatasync(newfd) != 0 || rename(tmp.c_str(), filename.c_str()) != 0) {
+		if (newfd != -1) {
+			close(newfd);
+		}
+		throw std::runtime_error(fmt::format("Can't write {}: {}", tmp, strerror(errno)));
+	}
+	std::lock_guard<std::mutex> lock(sync_mutex);
+	close(fd);
+	fd = newfd;
+	/* Everything appended so far is either in the new file, which is synced, or in the database */
+	synced = written;
+}
+
+coin_account_t& coin_ledger::load(uint64_t user_id, std::unique_lock<std::mutex> &lock)
+{
+	/* Accounts are never erased, so this reference stays valid while the lock is released */
+	coin_account_t& a = accounts[user_id];
+	for (bool retry = false; !a.loaded || a.expires <= time(NULL); retry = true) {
+		uint64_t started = epoch;
+		lock.unlock();
+		/* A retry holds off flushes while it reads, so it can't lose the race again */
+		std::unique_lock<std::mutex> flushing(flush_mutex, std::defer_lock);
+		if (retry) {
+			flushing.lock();
+		}
+		db::resultset rs = db::query("SELECT balance FROM coins WHERE user_id = '?'", {user_id});
+		bool failed = db::failed();
+		lock.lock();
+		if (failed) {
+			/* An expired balance is still better than none */
+			if (a.loaded) {
+				break;
+			}
+			throw std::runtime_error(fmt::format("Can't read coin balance of {}", user_id));
+		}
+		/* If a flush completed meanwhile, the balance may or may not include it */
+		if (epoch == started) {
+			a.base = rs.size() ? from_string<int64_t>(rs[0]["balance"], std::dec) : 0;
+			a.loaded = true;
+			a.expires = time(NULL) + COIN_BALANCE_TTL;
+		}
+	}
+	return a;
+}
+
+uint64_t coin_ledger::balance(uint64_t user_id)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	coin_account_t& a = load(user_id, lock);
+	return std::max<int64_t>(a.base + a.pending, 0);
+}
+
+uint64_t coin_ledger::drop(uint64_t user_id, uint64_t amount)
+{
+	coin_op_t op;
+	uint64_t current;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		coin_account_t& a = load(user_id, lock);
+		op = { next_seq++, COIN_DROP, 0, user_id, amount };
+		append(op);
+		journal.push_back(op);
+		a.pending += amount;
+		current = std::max<int64_t>(a.base + a.pending, 0);
+	}
+	sync(op.seq);
+	return current;
+}
+
+bool coin_ledger::give(uint64_t from, uint64_t to, uint64_t amount)
+{
+	coin_op_t op;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		coin_account_t& giver = load(from, lock);
+		if (giver.base + giver.pending < (int64_t)amount) {
+			return false;
+		}
+		op = { next_seq++, COIN_GIVE, from, to, amount };
+		append(op);
+		journal.push_back(op);
+		giver.pending -= amount;
+		accounts[to].pending += amount;
+	}
+	sync(op.seq);
+	return true;
+}
+
+bool coin_ledger::store(const std::vector<coin_op_t> &ops, size_t begin, size_t end, std::vector<bool> &refused, bool refuse)
+{
+	db::transaction t;
+	/* A commit which was reported as failed may still have gone through */
+	db::resultset state = t.query("SELECT last_seq FROM coin_ledger_state WHERE cluster_id = ? FOR UPDATE", {cluster_id});
+	uint64_t last_seq = state.size() ? from_string<uint64_t>(state[0]["last_seq"], std::dec) : 0;
+	/* Changes added earlier in this batch, which the database won't show until commit */
+	std::unordered_map<uint64_t, int64_t> batch;
+	std::vector<size_t> skipped;
+	for (size_t i = begin; i < end; ++i) {
+		const coin_op_t& op = ops[i];
+		if (op.seq <= last_seq) {
+			continue;
+		}
+		if (refuse) {
+			skipped.push_back(i);
+			continue;
+		}
+		if (op.type == COIN_GIVE) {
+			/* Coins may have been spent on the website since the give was accepted */
+			db::resultset rs = t.query("SELECT balance FROM coins WHERE user_id = '?' FOR UPDATE", {op.from});
+			int64_t available = (rs.size() ? from_string<int64_t>(rs[0]["balance"], std::dec) : 0) + batch[op.from];
+			if (available < (int64_t)op.amount) {
+				skipped.push_back(i);
+				continue;
+			}
+			t.add("CALL give_coins(?, ?, ?)", {op.amount, op.from, op.to});
+			batch[op.from] -= op.amount;
+		} else {
+			t.add("INSERT INTO coins (user_id, balance) VALUES(?, ?) ON DUPLICATE KEY UPDATE balance = balance + ?", {op.to, op.amount, op.amount});
+		}
+		batch[op.to] += op.amount;
+	}
+	t.add("INSERT INTO coin_ledger_state (cluster_id, last_seq) VALUES(?, ?) ON DUPLICATE KEY UPDATE last_seq = GREATEST(last_seq, ?)", {cluster_id, ops[end - 1].seq, ops[end - 1].seq});
+	if (!t.commit()) {
+		return false;
+	}
+	for (size_t i : skipped) {
+		refused[i] = true;
+	}
+	return true;
+}
+
+bool coin_ledger::flush(std::vector<coin_op_t> &failed)
+{
+	std::lock_guard<std::mutex> flushing(flush_mutex);
+	std::vector<coin_op_t> ops;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		ops.assign(journal.begin(), journal.end());
+	}
+	if (ops.empty()) {
+		return true;
+	}
+
+	std::vector<bool> refused(ops.size(), false);
+	size_t done = ops.size();
+	if (!store(ops, 0, ops.size(), refused, false)) {
+		/* One operation the database won't accept would hold up all the rest, so write them one at a time.
+		 * If one fails but marking it written succeeds, it is refused; if both fail, the database is unavailable.
+		 */
+		for (done = 0; done < ops.size(); ++done) {
+			if (!store(ops, done, done + 1, refused, false)) {
+				if (!store(ops, done, done + 1, refused, true)) {
+					break;
+				}
+				failed.push_back(ops[done]);
+			}
+		}
+		if (done == 0) {
+			return false;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t i = 0; i < done; ++i) {
+		const coin_op_t& op = ops[i];
+		journal.pop_front();
+		if (op.type == COIN_GIVE) {
+			coin_account_t& giver = accounts[op.from];
+			giver.pending += op.amount;
+			if (!refused[i]) {
+				giver.base -= op.amount;
+			}
+		}
+		coin_account_t& receiver = accounts[op.to];
+		receiver.pending -= op.amount;
+		if (!refused[i]) {
+			receiver.base += op.amount;
+		}
+	}
+	epoch++;
+	rewrite();
+	return done == ops.size();
+}
+
+void TriviaModule::WatchCoins()
+{
+	while (!terminating) {
+		for (int i = 0; i < COIN_FLUSH_SECS && !terminating; ++i) {
+			sleep(1);
+		}
+		/* This also runs once more after terminating is set, so nothing is left in the log on a clean shutdown */
+		try {
+			std::vector<coin_op_t> failed;
+			if (!coins->flush(failed)) {
+				bot->core->log(dpp::ll_warning, "Coin ledger flush failed, will retry");
+			}
+			for (auto& op : failed) {
+				bot->core->log(dpp::ll_error, fmt::format("Coin ledger entry {} ({} coins from {} to {}) was refused by the database and dropped", op.seq, op.amount, op.from, op.to));
+			}
+		}
+		catch (std::exception &e) {
+			bot->core->log(dpp::ll_error, fmt::format("Exception in WatchCoins: {}", e.what()));
+		}
+	}
+}
@@ -0,0 +1,124 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
+#include <ctime>
+#include <cstdint>
+
+// Number of seconds a balance read from the database is trusted, coins are also spent on the website
+#define COIN_BALANCE_TTL 30
+
+enum coin_op_type_t {
+	COIN_DROP = 0,
+	COIN_GIVE = 1
+};
+
+/* A change to balances which has not been written to the database yet */
+struct coin_op_t
+{
+	/* Increasing number, the last one written is stored in coin_ledger_state with the change itself */
+	uint64_t seq;
+	coin_op_type_t type;
+	/* Zero for a drop */
+	uint64_t from;
+	uint64_t to;
+	uint64_t amount;
+};
+
+struct coin_account_t
+{
+	/* True if base has been read from the database */
+	bool loaded;
+	/* Balance in the database when it was read, plus changes written since */
+	int64_t base;
+	/* Changes not yet written to the database */
+	int64_t pending;
+	time_t expires;
+};
+
+/* Coin balances of players. Drops and gives change the balances in memory straight away, under one lock,
+ * and are appended to a write-ahead log file before they are acknowledged. Callers which append at the
+ * same time share one sync of the log. flush() writes them to the database in one transaction, together
+ * with the sequence number of the last one, and then removes them from the log. Anything left in the log
+ * when the bot starts is written on the next flush, unless the database shows it was written already.
+ */
+class coin_ledger
+{
+	std::mutex mutex;
+	std::string filename;
+	uint32_t cluster_id;
+	int fd;
+	std::unordered_map<uint64_t, coin_account_t> accounts;
+	std::deque<coin_op_t> journal;
+	uint64_t next_seq;
+	/* Number of flushes so far, so that a balance read during a flush can be discarded */
+	uint64_t epoch;
+	/* Held by flush(), taken before mutex */
+	std::mutex flush_mutex;
+
+	/* Held while syncing or replacing the log, without holding mutex for the sync */
+	std::mutex sync_mutex;
+	/* Highest sequence number written to the log, and highest known to be on disk */
+	std::atomic<uint64_t> written;
+	uint64_t synced;
+
+	/* Append an operation to the log without syncing it. Caller holds the mutex. Throws std::runtime_error on I/O errors */
+	void append(const coin_op_t &op);
+	/* Wait until the log is on disk up to seq. Caller must not hold the mutex. Throws std::runtime_error on I/O errors */
+	void sync(uint64_t seq);
+	/* Replace the log with the operations still in the journal. Caller holds the mutex */
+	void rewrite();
+	/* Find an account, reading its balance if not known or expired. Caller holds the lock, which is released while reading.
+	 * Throws std::runtime_error if the balance has never been read and can't be.
+	 */
+	coin_account_t& load(uint64_t user_id, std::unique_lock<std::mutex> &lock);
+	/* Write ops[begin..end) in one transaction, or only mark them written if refuse is true. Sets refused for gives
+	 * which no longer fit. Returns false if the transaction failed.
+	 */
+	bool store(const std::vector<coin_op_t> &ops, size_t begin, size_t end, std::vector<bool> &refused, bool refuse);
+public:
+	/* Opens the log, replaying anything left in it. Throws std::runtime_error on I/O errors */
+	coin_ledger(const std::string &filename, uint32_t cluster_id);
+	~coin_ledger();
+	coin_ledger(const coin_ledger&) = delete;
+	coin_ledger& operator=(const coin_ledger&) = delete;
+
+	uint64_t balance(uint64_t user_id);
+
+	/* Award coins to a player, returns their new balance */
+	uint64_t drop(uint64_t user_id, uint64_t amount);
+
+	/* Move coins from one player to another, returns false if the giver hasn't got enough */
+	bool give(uint64_t from, uint64_t to, uint64_t amount);
+
+	/* Write outstanding changes to the database. Only one thread may call this. Operations the database
+	 * would not accept are dropped and added to failed. Returns false if anything is left to write.
+	 */
+	bool flush(std::vector<coin_op_t> &failed);
+};
@@ -51,16 +51,16 @@ command_t::~command_t()
 {
 }
 
-std::string command_t::_(const std::string &str, const guild_settings_t &settings)
+std::string command_t::_(lang_key str, const guild_settings_t &settings)
 {
 	return creator->_(str, settings);
 }
 
-void command_t::select_click(const dpp::select_click_t & event, const in_cmd &cmd, guild_settings_t &settings)
+void command_t::select_click(const dpp::select_click_t & event, const in_cmd &cmd, const guild_settings_t &settings)
 {
 }
 
-void command_t::button_click(const dpp::button_click_t & event, const in_cmd &cmd, guild_settings_t &settings)
+void command_t::button_click(const dpp::button_click_t & event, const in_cmd &cmd, const guild_settings_t &settings)
 {
 }
 
@@ -108,7 +108,12 @@ void TriviaModule::SetupCommands()
 			}
 		)},
 		{"dashboard", new command_dashboard_t(this, "dashboard", false, "Show a link to the TriviaBot dashboard", { })},
-		{"global", new command_global_t(this, "global", false, "Show a link to the global leaderboard", { })},
+		{
+			"global", new command_global_t(this, "global", false, "Show the global leaderboard",
+			{
+				dpp::command_option(dpp::co_string, "page", "Page number to show", false)
+			}
+		)},
 		{"dash", new command_dashboard_t(this, "dashboard", false, "", { } )},
 		{"vote", new command_vote_t(this, "vote", false, "Information on how to vote for TriviaBot", { })},
 		{"invite", new command_invite_t(this, "invite", false, "Show TriviaBot's invite link", { })},
@@ -352,8 +357,7 @@ void TriviaModule::HandleSelect(const dpp::select_click_t & event) {
 		in_cmd cmd(event.values[0], event.command.usr.id, event.command.channel_id, event.command.guild_id, false, event.command.usr.username, false, event.command.usr, event.command.member);
 		cmd.command_id = event.command.id;
 		cmd.interaction_token = event.command.token;
-		guild_settings_t settings = GetGuildSettings(cmd.guild_id);
-		command->second->select_click(event, cmd, settings);
+		command->second->select_click(event, cmd, *GetGuildSettings(cmd.guild_id));
 	}
 }
 
@@ -365,8 +369,7 @@ void TriviaModule::HandleButton(const dpp::button_click_t & event) {
 		in_cmd cmd(remainder, event.command.usr.id, event.command.channel_id, event.command.guild_id, false, event.command.usr.username, false, event.command.usr, event.command.member);
 		cmd.command_id = event.command.id;
 		cmd.interaction_token = event.command.token;
-		guild_settings_t settings = GetGuildSettings(cmd.guild_id);
-		command->second->button_click(event, cmd, settings);
+		command->second->button_click(event, cmd, *GetGuildSettings(cmd.guild_id));
 	}
 }
 
@@ -495,7 +498,8 @@ void TriviaModule::handle_command(const in_cmd &cmd, const dpp::interaction_crea
 				return;
 			}
 	
-			guild_settings_t settings = GetGuildSettings(cmd.guild_id);
+			guild_settings_ptr settings_ptr = GetGuildSettings(cmd.guild_id);
+			const guild_settings_t& settings = *settings_ptr;
 	
 			/* Check for moderator status - first check if owner */
 			dpp::guild* g = dpp::find_guild(cmd.guild_id);
@@ -608,32 +612,21 @@ void TriviaModule::handle_command(const in_cmd &cmd, const dpp::interaction_crea
  */
 void TriviaModule::GetHelp(const std::string& interaction_token, dpp::snowflake command_id, const std::string &section, dpp::snowflake channelID, const std::string &botusername, dpp::snowflake botid, const std::string &author, dpp::snowflake authorid, const guild_settings_t &settings)
 {
-	json embed_json;
 	char timestamp[256];
 	time_t timeval = time(NULL);
 	int32_t colour = settings.embedcolour;
 
-	std::ifstream t("../help/" + settings.language + "/" + (section.empty() ? "basic" : section) + ".json");
-	if (!t) {
-		t = std::ifstream("../help/" + settings.language + "/error.json");
+	std::shared_ptr<const help_pages> pages;
+	{
+		std::shared_lock help_lock(help_mutex);
+		pages = help;
 	}
-	std::string json((std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());
-
-	tm _tm;
-	gmtime_r(&timeval, &_tm);
-	strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &_tm);
-
-	json = ReplaceString(json, ":section:" , section);
-	json = ReplaceString(json, ":user:", botusername);
-	json = ReplaceString(json, ":id:", std::to_string(botid));
-	json = ReplaceString(json, ":author:", author);
-	json = ReplaceString(json, ":ts:", timestamp);
-	json = ReplaceString(json, ":color:", std::to_string(colour));
-
-	try {
-		embed_json = json::parse(json);
+	const help_template* page = pages->find(settings.language, section.empty() ? "basic" : section);
+	if (!page) {
+		page = pages->find(settings.language, "error");
 	}
-	catch (const std::exception &e) {
+
+	if (!page || !page->valid) {
 		if (!bot->IsTestMode() || from_string<uint64_t>(Bot::GetConfig("test_server"), std::dec) == settings.guild_id) {
 			bot->core->message_create(dpp::message(channelID, fmt::format(_("HERPDERP", settings), authorid)));
 			bot->sent_messages++;
@@ -642,6 +635,11 @@ void TriviaModule::GetHelp(const std::string& interaction_token, dpp::snowflake
 		return;
 	}
 
-	ProcessEmbed(interaction_token, command_id, settings, json, channelID);
+	tm _tm;
+	gmtime_r(&timeval, &_tm);
+	strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &_tm);
+
+	/* Text values are escaped so that names containing quotes can't break the json */
+	ProcessEmbed(interaction_token, command_id, settings, page->render({ escape_json(section), escape_json(botusername), std::to_string(botid), escape_json(author), timestamp, std::to_string(colour) }), channelID);
 }
 
@@ -3,10 +3,11 @@
 #include <string>
 #include <map>
 #include "settings.h"
+#include "lang.h"
 #include <dpp/dpp.h>
 
-#define DECLARE_COMMAND_CLASS(__command_name__, __ancestor__) class __command_name__ : public __ancestor__ { public: __command_name__(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options); virtual void call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user); virtual ~__command_name__() = default; };
-#define DECLARE_COMMAND_CLASS_SELECT(__command_name__, __ancestor__) class __command_name__ : public __ancestor__ { public: __command_name__(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options); virtual void call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user); virtual ~__command_name__() = default; virtual void select_click(const dpp::select_click_t & event, const in_cmd &cmd, guild_settings_t &settings); virtual void button_click(const dpp::button_click_t & event, const in_cmd &cmd, guild_settings_t &settings);  };
+#define DECLARE_COMMAND_CLASS(__command_name__, __ancestor__) class __command_name__ : public __ancestor__ { public: __command_name__(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options); virtual void call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user); virtual ~__command_name__() = default; };
+#define DECLARE_COMMAND_CLASS_SELECT(__command_name__, __ancestor__) class __command_name__ : public __ancestor__ { public: __command_name__(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options); virtual void call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user); virtual ~__command_name__() = default; virtual void select_click(const dpp::select_click_t & event, const in_cmd &cmd, const guild_settings_t &settings); virtual void button_click(const dpp::button_click_t & event, const in_cmd &cmd, const guild_settings_t &settings);  };
 
 #define BLANK_EMOJI "<:blank:667278047006949386>"
 
@@ -32,7 +33,7 @@ class command_t
  protected:
  	 class TriviaModule* creator;
 	std::string base_command;
-	std::string _(const std::string &str, const guild_settings_t &settings);
+	std::string _(lang_key str, const guild_settings_t &settings);
  public:
 	bool admin;
 	bool ephemeral;
@@ -40,9 +41,9 @@ class command_t
  	std::string description;
 	std::vector<dpp::command_option> opts;
 	command_t(class TriviaModule* _creator, const std::string &_base_command, bool adm, const std::string& descr, std::vector<dpp::command_option> options, bool is_ephemeral = false, dpp::slashcommand_contextmenu_type command_type = dpp::ctxm_chat_input);
-	virtual void call(const in_cmd &cmd, std::stringstream &tokens, guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user) = 0;
-	virtual void select_click(const dpp::select_click_t & event, const in_cmd &cmd, guild_settings_t &settings);
-	virtual void button_click(const dpp::button_click_t & event, const in_cmd &cmd, guild_settings_t &settings);
+	virtual void call(const in_cmd &cmd, std::stringstream &tokens, const guild_settings_t &settings, const std::string &username, bool is_moderator, dpp::channel* c, dpp::user* user) = 0;
+	virtual void select_click(const dpp::select_click_t & event, const in_cmd &cmd, const guild_settings_t &settings);
+	virtual void button_click(const dpp::button_click_t & event, const in_cmd &cmd, const guild_settings_t &settings);
 	virtual ~command_t();
 };
 
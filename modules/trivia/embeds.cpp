@@ -121,24 +121,9 @@ void TriviaModule::ProcessEmbed(const std::string& interaction_token, dpp::snowf
 		}
 
 		/* Check if this channel has a webhook. If it does, use it! */
-		std::string webhook_id;
-		{
-			std::shared_lock lock(this->wh_mutex);
-			auto i = this->webhooks.find(channelID);
-			if (i != this->webhooks.end()) {
-				webhook_id = i->second;
-			}
-		}
-		if (webhook_id.empty()) {
-			db::resultset rs = db::query("SELECT * FROM channel_webhooks WHERE channel_id = ?", {channelID});
-			if (rs.size()) {
-				std::unique_lock lock(this->wh_mutex);
-				webhook_id = rs[0]["webhook"];
-				this->webhooks[channelID] = webhook_id;
-			}
-		}
-		if (!webhook_id.empty()) {
-			post_webhook(webhook_id, cleaned_json, channelID);
+		webhook_t wh = webhooks->get(channelID);
+		if (wh.id) {
+			post_webhook(wh.url, cleaned_json, channelID);
 		} else {
 			bot->core->message_create(dpp::message(channelID, dpp::embed(&embed)));
 		}
@@ -0,0 +1,170 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <dpp/dpp.h>
+#include <fmt/format.h>
+#include <dpp/nlohmann/json.hpp>
+#include <sporks/modules.h>
+#include <string>
+#include <cstdint>
+#include "state.h"
+#include "trivia.h"
+
+using json = nlohmann::json;
+
+/* Live games are handed from one instance of the module to the next across a reload,
+ * serialised as msgpack and held by the ModuleLoader while no module code is loaded.
+ */
+
+question_t::question_t(const json &j) :
+	id(j["id"].get<uint64_t>()), guild_id(j["guild_id"].get<uint64_t>()), question(j["question"].get<std::string>()), answer(j["answer"].get<std::string>()),
+	customhint1(j["customhint1"].get<std::string>()), customhint2(j["customhint2"].get<std::string>()), catname(j["catname"].get<std::string>()),
+	lastasked(j["lastasked"].get<time_t>()), timesasked(j["timesasked"].get<uint32_t>()), lastcorrect(j["lastcorrect"].get<std::string>()), recordtime(j["recordtime"].get<double>()),
+	shuffle1(j["shuffle1"].get<std::string>()), shuffle2(j["shuffle2"].get<std::string>()), question_image(j["question_image"].get<std::string>()), answer_image(j["answer_image"].get<std::string>())
+{
+}
+
+json question_t::to_json() const
+{
+	return {
+		{ "id", id }, { "guild_id", (uint64_t)guild_id }, { "question", question }, { "answer", answer }, { "customhint1", customhint1 }, { "customhint2", customhint2 },
+		{ "catname", catname }, { "lastasked", lastasked }, { "timesasked", timesasked }, { "lastcorrect", lastcorrect }, { "recordtime", recordtime },
+		{ "shuffle1", shuffle1 }, { "shuffle2", shuffle2 }, { "question_image", question_image }, { "answer_image", answer_image }
+	};
+}
+
+state_t::state_t(TriviaModule* _creator, const json &j) :
+	creator(_creator),
+	next_tick(j["next_tick"].get<time_t>()),
+	terminating(false),
+	channel_id(j["channel_id"].get<uint64_t>()),
+	guild_id(j["guild_id"].get<uint64_t>()),
+	numquestions(j["numquestions"].get<uint32_t>()),
+	round(j["round"].get<uint32_t>()),
+	score(j["score"].get<uint32_t>()),
+	start_time(j["start_time"].get<time_t>()),
+	shuffle_list(j["shuffle_list"].get<std::vector<std::string>>()),
+	gamestate((trivia_state_t)j["gamestate"].get<uint32_t>()),
+	question(j["question"]),
+	original_answer(j["original_answer"].get<std::string>()),
+	last_to_answer(j["last_to_answer"].get<uint64_t>()),
+	streak(j["streak"].get<uint32_t>()),
+	asktime(j["asktime"].get<time_t>()),
+	found(j["found"].get<bool>()),
+	interval(j["interval"].get<time_t>()),
+	insane_num(j["insane_num"].get<uint32_t>()),
+	insane_left(j["insane_left"].get<uint32_t>()),
+	next_quickfire(j["next_quickfire"].get<time_t>()),
+	hintless(j["hintless"].get<bool>()),
+	insane(j["insane"].get<std::map<std::string, bool>>()),
+	activity(j["activity"].get<std::map<uint64_t, time_t>>())
+{
+	/* Snowflake keyed maps are stored as arrays of pairs, as json object keys must be strings */
+	for (auto& s : j["insane_round_stats"]) {
+		insane_round_stats[s[0].get<uint64_t>()] = s[1].get<uint32_t>();
+	}
+	for (auto& q : j["question_cache"]) {
+		question_cache.emplace_back(q);
+	}
+	creator->leaderboard->warm(guild_id);
+}
+
+json state_t::to_json() const
+{
+	json j = {
+		{ "next_tick", next_tick },
+		{ "channel_id", channel_id },
+		{ "guild_id", guild_id },
+		{ "numquestions", numquestions },
+		{ "round", round },
+		{ "score", score },
+		{ "start_time", start_time },
+		{ "shuffle_list", shuffle_list },
+		{ "gamestate", (uint32_t)gamestate },
+		{ "question", question.to_json() },
+		{ "original_answer", original_answer },
+		{ "last_to_answer", last_to_answer },
+		{ "streak", streak },
+		{ "asktime", asktime },
+		{ "found", found },
+		{ "interval", interval },
+		{ "insane_num", insane_num },
+		{ "insane_left", insane_left },
+		{ "next_quickfire", next_quickfire },
+		{ "hintless", hintless },
+		{ "insane", insane },
+		{ "activity", activity },
+		{ "insane_round_stats", json::array() },
+		{ "question_cache", json::array() }
+	};
+	for (auto& s : insane_round_stats) {
+		j["insane_round_stats"].push_back({ (uint64_t)s.first, s.second });
+	}
+	for (auto& q : question_cache) {
+		j["question_cache"].push_back(q.to_json());
+	}
+	return j;
+}
+
+/* Store all live games with the module loader, for the next instance of this module to adopt.
+ * The caller must have stopped the game tick thread.
+ */
+void TriviaModule::HandOffGames()
+{
+	double start = dpp::utility::time_f();
+	json games = { { "version", HANDOFF_VERSION }, { "games", json::array() } };
+	std::lock_guard<std::mutex> states_lock(states_mutex);
+	for (auto& s : states) {
+		if (!s.second.terminating && s.second.gamestate != TRIV_END) {
+			games["games"].push_back(s.second.to_json());
+		}
+	}
+	std::vector<uint8_t> data = json::to_msgpack(games);
+	bot->Loader->SetHandoff(HANDOFF_NAME, std::string(data.begin(), data.end()));
+	bot->core->log(dpp::ll_info, fmt::format("Handed off {} games ({} bytes) in {:.03f} seconds", games["games"].size(), data.size(), dpp::utility::time_f() - start));
+}
+
+/* Adopt live games left by a previous instance of this module, if it was reloaded */
+void TriviaModule::AdoptGames()
+{
+	std::string data = bot->Loader->TakeHandoff(HANDOFF_NAME, HANDOFF_MAX_AGE);
+	if (data.empty()) {
+		return;
+	}
+	double start = dpp::utility::time_f();
+	try {
+		json games = json::from_msgpack(data);
+		if (games["version"].get<uint32_t>() != HANDOFF_VERSION) {
+			bot->core->log(dpp::ll_warning, fmt::format("Not adopting games handed off by a different module version ({})", games["version"].get<uint32_t>()));
+			return;
+		}
+		std::lock_guard<std::mutex> states_lock(states_mutex);
+		for (auto& g : games["games"]) {
+			uint64_t channel_id = g["channel_id"];
+			states[channel_id] = state_t(this, g);
+		}
+		bot->core->log(dpp::ll_info, fmt::format("Adopted {} games from previous module instance in {:.03f} seconds", games["games"].size(), dpp::utility::time_f() - start));
+	}
+	catch (const std::exception &e) {
+		bot->core->log(dpp::ll_error, fmt::format("Can't adopt games from previous module instance: {}", e.what()));
+	}
+}
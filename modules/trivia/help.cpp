@@ -0,0 +1,176 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <dpp/dpp.h>
+#include <fmt/format.h>
+#include <dpp/nlohmann/json.hpp>
+#include <sporks/modules.h>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <fstream>
+#include <streambuf>
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "trivia.h"
+#include "help.h"
+
+using json = nlohmann::json;
+
+static const char* placeholders[HELP_SLOT_COUNT] = { ":section:", ":user:", ":id:", ":author:", ":ts:", ":color:" };
+
+help_template::help_template(const std::string &content) : text(content)
+{
+	size_t literal = 0, pos = 0;
+	while ((pos = text.find(':', pos)) != std::string::npos) {
+		int slot = 0;
+		for (; slot < HELP_SLOT_COUNT; ++slot) {
+			if (text.compare(pos, strlen(placeholders[slot]), placeholders[slot]) == 0) {
+				break;
+			}
+		}
+		if (slot == HELP_SLOT_COUNT) {
+			pos++;
+			continue;
+		}
+		parts.push_back({ (uint32_t)literal, (uint32_t)(pos - literal), (help_slot)slot });
+		pos += strlen(placeholders[slot]);
+		literal = pos;
+	}
+	parts.push_back({ (uint32_t)literal, (uint32_t)(text.length() - literal), HELP_SLOT_COUNT });
+
+	/* Check the file once with placeholder values, rather than on every render */
+	valid = json::accept(render({ "section", "user", "0", "author", "1970-01-01 00:00:00", "0" }));
+}
+
+std::string help_template::render(const help_values_t &values) const
+{
+	size_t length = text.length();
+	for (auto& p : parts) {
+		if (p.slot != HELP_SLOT_COUNT) {
+			length += values[p.slot].length();
+		}
+	}
+	std::string out;
+	out.reserve(length);
+	for (auto& p : parts) {
+		out.append(text, p.offset, p.length);
+		if (p.slot != HELP_SLOT_COUNT) {
+			out.append(values[p.slot]);
+		}
+	}
+	return out;
+}
+
+/* Returns the names of the entries in a directory, skipping hidden entries */
+static std::vector<std::string> list_directory(const std::string &directory)
+{
+	std::vector<std::string> names;
+	DIR* d = opendir(directory.c_str());
+	if (d) {
+		while (struct dirent* e = readdir(d)) {
+			if (e->d_name[0] != '.') {
+				names.push_back(e->d_name);
+			}
+		}
+		closedir(d);
+	}
+	return names;
+}
+
+help_pages::help_pages(const std::string &directory, std::vector<std::string> &errors)
+{
+	for (auto& language : list_directory(directory)) {
+		for (auto& file : list_directory(directory + "/" + language)) {
+			if (file.length() <= 5 || file.substr(file.length() - 5) != ".json") {
+				continue;
+			}
+			std::ifstream t(directory + "/" + language + "/" + file);
+			std::string content((std::istreambuf_iterator<char>(t)), std::istreambuf_iterator<char>());
+			auto page = pages.emplace(language + "/" + file.substr(0, file.length() - 5), help_template(content));
+			if (!page.first->second.valid) {
+				errors.push_back(language + "/" + file);
+			}
+		}
+	}
+}
+
+const help_template* help_pages::find(const std::string &language, const std::string &section) const
+{
+	auto page = pages.find(language + "/" + section);
+	return page != pages.end() ? &page->second : nullptr;
+}
+
+size_t help_pages::size() const
+{
+	return pages.size();
+}
+
+/* Load all help files, replacing the current set */
+void TriviaModule::LoadHelp()
+{
+	std::vector<std::string> errors;
+	auto pages = std::make_shared<const help_pages>("../help", errors);
+	for (auto& file : errors) {
+		bot->core->log(dpp::ll_error, fmt::format("Malformed help file {}!", file));
+	}
+	bot->core->log(dpp::ll_info, fmt::format("Help files loaded: {}", pages->size()));
+	std::unique_lock help_lock(help_mutex);
+	help = pages;
+}
+
+/* Reload help files when they change on disk */
+void TriviaModule::WatchHelp()
+{
+	int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd == -1) {
+		bot->core->log(dpp::ll_warning, fmt::format("Can't watch help files for changes: {}", strerror(errno)));
+		return;
+	}
+	const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+	inotify_add_watch(fd, "../help", mask);
+	for (auto& language : list_directory("../help")) {
+		inotify_add_watch(fd, ("../help/" + language).c_str(), mask);
+	}
+	char events[4096];
+	while (!terminating) {
+		struct pollfd p = { fd, POLLIN, 0 };
+		if (poll(&p, 1, 1000) > 0) {
+			/* Editors often write a file in several steps, so let them finish before reloading once */
+			sleep(1);
+			while (read(fd, events, sizeof(events)) > 0);
+			for (auto& language : list_directory("../help")) {
+				/* Adding an existing watch is harmless, and picks up new language directories */
+				inotify_add_watch(fd, ("../help/" + language).c_str(), mask);
+			}
+			try {
+				LoadHelp();
+			}
+			catch (std::exception &e) {
+				bot->core->log(dpp::ll_error, fmt::format("Exception in WatchHelp: {}", e.what()));
+			}
+		}
+	}
+	close(fd);
+}
@@ -0,0 +1,78 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <cstdint>
+
+/* Placeholders which may appear in a help file, e.g. ":user:" */
+enum help_slot {
+	HELP_SECTION = 0,
+	HELP_USER,
+	HELP_ID,
+	HELP_AUTHOR,
+	HELP_TS,
+	HELP_COLOR,
+	HELP_SLOT_COUNT
+};
+
+typedef std::array<std::string, HELP_SLOT_COUNT> help_values_t;
+
+/* A help file split at its placeholders, so that rendering is one pass over its parts */
+class help_template
+{
+	struct part {
+		uint32_t offset;
+		uint32_t length;
+		/* Slot to insert after the literal text, or HELP_SLOT_COUNT for none */
+		help_slot slot;
+	};
+	std::string text;
+	std::vector<part> parts;
+public:
+	/* False if the file is not valid json once its placeholders are filled in */
+	bool valid;
+
+	help_template(const std::string &content);
+	std::string render(const help_values_t &values) const;
+};
+
+/* All help files for all languages, loaded once. A set is never modified after it is
+ * loaded; reloads build a new set and replace the shared pointer to it.
+ */
+class help_pages
+{
+	/* Keyed by "<language>/<section>" */
+	std::unordered_map<std::string, help_template> pages;
+public:
+	/* Load every <directory>/<language>/<section>.json. Names of malformed files are added to errors */
+	help_pages(const std::string &directory, std::vector<std::string> &errors);
+
+	/* Returns nullptr if there is no such help file */
+	const help_template* find(const std::string &language, const std::string &section) const;
+
+	size_t size() const;
+};
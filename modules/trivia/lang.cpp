@@ -44,28 +44,27 @@ time_t get_mtime(const char *path)
 	return statbuf.st_mtime;
 }
 
-// Check for updated lang.json and attempt to reload it. if reloading fails, dont try again until its 
-// modified a second time. Log errors to log file.
+// Check for an updated lang.bin and attempt to reload it. if reloading fails, dont try again until its 
+// modified a second time. Log errors to log file. lang.bin is rebuilt from lang.json by running make.
 void TriviaModule::CheckLangReload()
 {
-	if (get_mtime("../lang.json") > lastlang) {
-		std::unique_lock lang_lock(lang_mutex);
-		lastlang = get_mtime("../lang.json");
-		std::ifstream langfile("../lang.json");
-		json* newlang = new json();
+	std::unique_lock lang_lock(lang_mutex);
+	/* Views into a replaced table are only used while building a message, so old tables can go after a while */
+	while (!retired_lang.empty() && retired_lang.front().first + LANG_RETIRE_SECS <= time(NULL)) {
+		delete retired_lang.front().second;
+		retired_lang.pop_front();
+	}
+	if (get_mtime("lang.bin") > lastlang) {
+		lastlang = get_mtime("lang.bin");
 		try {
-			json* oldlang = this->lang;
-	
-			// Parse updated contents
-			langfile >> *newlang;
-	
-			this->lang = newlang;
-			delete oldlang;
+			/* Map the updated table, then publish it */
+			const lang_table* oldlang = lang.exchange(new lang_table("lang.bin"));
+
+			/* Other threads may still hold views into the old table, so it is kept for LANG_RETIRE_SECS */
+			retired_lang.emplace_back(time(NULL), oldlang);
 		}
 		catch (const std::exception &e) {
-			bot->core->log(dpp::ll_error, fmt::format("Error in lang.json: ", e.what()));
-			// Delete attempted new language file to prevent memory leaks
-			delete newlang;
+			bot->core->log(dpp::ll_error, fmt::format("Error in lang.bin: {}", e.what()));
 		}
 
 	}
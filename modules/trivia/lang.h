@@ -0,0 +1,115 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+
+#include <dpp/nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+/* FNV-1a hash of a language key. This is constexpr so that for the string literals
+ * passed to _() the optimiser resolves the key id at compile time.
+ */
+constexpr uint64_t lang_hash(const char* s)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	while (*s) {
+		h = (h ^ (uint8_t)*s++) * 0x100000001b3ULL;
+	}
+	return h;
+}
+
+/* An interned language key, e.g. "Q_QUESTION". Constructed implicitly from the
+ * key name, so callers keep writing _("KEY", settings).
+ */
+struct lang_key
+{
+	uint64_t id;
+	std::string_view name;
+
+	constexpr lang_key(const char* k) : id(lang_hash(k)), name(k) { }
+	lang_key(const std::string &k) : id(lang_hash(k.c_str())), name(k) { }
+};
+
+/* Layout of lang.bin, which the langc build step compiles from lang.json:
+ *
+ * lang_blob_header
+ * char[LANG_CODE_SIZE] * language_count        language codes, NUL padded
+ * uint64_t * key_count                         key ids, ascending
+ * lang_blob_string * key_count * language_count
+ * char * arena_size                            string arena
+ *
+ * Integers are in host byte order, as the file is built on the machine that runs the bot.
+ */
+#define LANG_BLOB_MAGIC "TRVLANG1"
+#define LANG_BLOB_VERSION 1
+#define LANG_CODE_SIZE 8
+#define LANG_MISSING 0xFFFFFFFF
+
+struct lang_blob_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t language_count;
+	uint32_t key_count;
+	uint32_t arena_size;
+};
+
+struct lang_blob_string
+{
+	/* Offset into the arena, or LANG_MISSING if there is no translation */
+	uint32_t offset;
+	uint32_t length;
+};
+
+/* A compiled lang.bin, mapped read-only into memory. A table is never modified once
+ * loaded, so it can be read without locking; a reload maps a new table and swaps the pointer.
+ */
+class lang_table
+{
+	void* blob;
+	size_t blob_size;
+	const lang_blob_header* header;
+	const char (*languages)[LANG_CODE_SIZE];
+	const uint64_t* keys;
+	const lang_blob_string* strings;
+	const char* arena;
+public:
+	/* Maps and validates a compiled file. Throws std::runtime_error if it can't be read or is corrupt */
+	lang_table(const std::string &filename);
+	~lang_table();
+	lang_table(const lang_table&) = delete;
+	lang_table& operator=(const lang_table&) = delete;
+
+	/* Returns the string for key k in the given language, or a view with a null data() if there is none.
+	 * The key name is not returned instead, as it may belong to a temporary string.
+	 */
+	std::string_view get(const lang_key &k, const std::string &language) const;
+
+	size_t size() const;
+
+	/* Compiles the contents of lang.json into a blob for lang_table to map. Throws std::runtime_error
+	 * if the json is not an object of objects of strings, or if two keys have the same id.
+	 */
+	static std::string compile(const nlohmann::json &j);
+};
@@ -0,0 +1,179 @@
+/************************************************************************************
+ * 
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <fmt/format.h>
+#include <dpp/nlohmann/json.hpp>
+#include <string>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "lang.h"
+
+using json = nlohmann::json;
+
+lang_table::lang_table(const std::string &filename) : blob(MAP_FAILED), blob_size(0)
+{
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd == -1) {
+		throw std::runtime_error(fmt::format("Can't open {}: {}", filename, strerror(errno)));
+	}
+	struct stat statbuf;
+	if (fstat(fd, &statbuf) == 0 && statbuf.st_size >= (off_t)sizeof(lang_blob_header)) {
+		blob_size = statbuf.st_size;
+		blob = mmap(nullptr, blob_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (blob == MAP_FAILED) {
+		throw std::runtime_error(fmt::format("Can't map {}, it is empty or truncated", filename));
+	}
+
+	/* Check the file is complete and consistent before handing out views into it */
+	const char* base = (const char*)blob;
+	header = (const lang_blob_header*)base;
+	uint64_t expected_size = sizeof(lang_blob_header) + (uint64_t)header->language_count * LANG_CODE_SIZE +
+		(uint64_t)header->key_count * sizeof(uint64_t) + (uint64_t)header->key_count * header->language_count * sizeof(lang_blob_string) +
+		header->arena_size;
+	if (memcmp(header->magic, LANG_BLOB_MAGIC, sizeof(header->magic)) || header->version != LANG_BLOB_VERSION || expected_size != blob_size) {
+		munmap(blob, blob_size);
+		throw std::runtime_error(fmt::format("{} is not a valid compiled language file, rebuild it from lang.json", filename));
+	}
+	languages = (const char (*)[LANG_CODE_SIZE])(base + sizeof(lang_blob_header));
+	keys = (const uint64_t*)(languages + header->language_count);
+	strings = (const lang_blob_string*)(keys + header->key_count);
+	arena = (const char*)(strings + (size_t)header->key_count * header->language_count);
+
+	bool valid = std::is_sorted(keys, keys + header->key_count);
+	for (size_t n = 0; valid && n < (size_t)header->key_count * header->language_count; ++n) {
+		valid = strings[n].offset == LANG_MISSING || (uint64_t)strings[n].offset + strings[n].length <= header->arena_size;
+	}
+	if (!valid) {
+		munmap(blob, blob_size);
+		throw std::runtime_error(fmt::format("{} is corrupt, rebuild it from lang.json", filename));
+	}
+}
+
+lang_table::~lang_table()
+{
+	munmap(blob, blob_size);
+}
+
+std::string_view lang_table::get(const lang_key &k, const std::string &language) const
+{
+	const uint64_t* row = std::lower_bound(keys, keys + header->key_count, k.id);
+	if (row != keys + header->key_count && *row == k.id) {
+		for (uint32_t l = 0; l < header->language_count; ++l) {
+			if (language == std::string_view(languages[l], strnlen(languages[l], LANG_CODE_SIZE))) {
+				const lang_blob_string& s = strings[(row - keys) * header->language_count + l];
+				if (s.offset != LANG_MISSING) {
+					return std::string_view(arena + s.offset, s.length);
+				}
+				break;
+			}
+		}
+	}
+	return std::string_view();
+}
+
+size_t lang_table::size() const
+{
+	return header->key_count;
+}
+
+std::string lang_table::compile(const json &j)
+{
+	if (!j.is_object()) {
+		throw std::runtime_error("lang.json must be an object of language keys");
+	}
+
+	/* Collect every language used by any key, in order of first appearance */
+	std::vector<std::string> codes;
+	for (auto k = j.begin(); k != j.end(); ++k) {
+		if (!k->is_object()) {
+			throw std::runtime_error(fmt::format("Language key {} is not an object", k.key()));
+		}
+		for (auto l = k->begin(); l != k->end(); ++l) {
+			if (l.key().empty() || l.key().length() > LANG_CODE_SIZE) {
+				throw std::runtime_error(fmt::format("Language key {} has an invalid language code '{}'", k.key(), l.key()));
+			}
+			if (std::find(codes.begin(), codes.end(), l.key()) == codes.end()) {
+				codes.push_back(l.key());
+			}
+		}
+	}
+
+	/* Key rows are ordered by id so lookups can binary search them */
+	std::vector<std::pair<uint64_t, json::const_iterator>> rows;
+	for (auto k = j.begin(); k != j.end(); ++k) {
+		rows.emplace_back(lang_hash(k.key().c_str()), k);
+	}
+	std::sort(rows.begin(), rows.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+	for (size_t n = 1; n < rows.size(); ++n) {
+		if (rows[n].first == rows[n - 1].first) {
+			throw std::runtime_error(fmt::format("Language keys {} and {} have the same id", rows[n - 1].second.key(), rows[n].second.key()));
+		}
+	}
+
+	std::string arena;
+	std::vector<lang_blob_string> strings;
+	for (auto& row : rows) {
+		for (auto& code : codes) {
+			auto v = row.second->find(code);
+			if (v == row.second->end()) {
+				strings.push_back({ LANG_MISSING, 0 });
+			} else if (!v->is_string()) {
+				throw std::runtime_error(fmt::format("Language key {} in {} is not a string", row.second.key(), code));
+			} else {
+				const std::string& text = v->get_ref<const std::string&>();
+				strings.push_back({ (uint32_t)arena.length(), (uint32_t)text.length() });
+				arena.append(text);
+			}
+		}
+	}
+	if (arena.length() >= LANG_MISSING) {
+		throw std::runtime_error("Language strings are too large to compile");
+	}
+
+	lang_blob_header header;
+	memcpy(header.magic, LANG_BLOB_MAGIC, sizeof(header.magic));
+	header.version = LANG_BLOB_VERSION;
+	header.language_count = codes.size();
+	header.key_count = rows.size();
+	header.arena_size = arena.length();
+
+	std::string out((const char*)&header, sizeof(header));
+	for (auto& code : codes) {
+		out.append(code).append(LANG_CODE_SIZE - code.length(), '\0');
+	}
+	for (auto& row : rows) {
+		out.append((const char*)&row.first, sizeof(row.first));
+	}
+	out.append((const char*)strings.data(), strings.size() * sizeof(lang_blob_string));
+	out.append(arena);
+	return out;
+}
@@ -0,0 +1,228 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <sporks/database.h>
+#include <sporks/stringops.h>
+#include "leaderboard.h"
+
+time_t period_end(leaderboard_period_t period, time_t now)
+{
+	time_t day = now - (now % 86400);
+	switch (period) {
+		case LB_WEEK: {
+			/* 1st Jan 1970 was a Thursday */
+			time_t weekday = ((day / 86400) + 3) % 7;
+			return day + (7 - weekday) * 86400;
+		}
+		case LB_MONTH: {
+			struct tm t;
+			gmtime_r(&now, &t);
+			t.tm_mday = 1;
+			t.tm_mon++;
+			t.tm_hour = t.tm_min = t.tm_sec = 0;
+			/* timegm() normalises December + 1 into January of the next year */
+			return timegm(&t);
+		}
+		default:
+			return day + 86400;
+	}
+}
+
+bool guild_leaderboard_t::place(leaderboard_period_t period, uint64_t user_id, uint64_t score)
+{
+	std::vector<leaderboard_entry_t>& t = top[period];
+	auto i = std::find_if(t.begin(), t.end(), [user_id](const leaderboard_entry_t& e) { return e.user_id == user_id; });
+	if (i == t.end()) {
+		if (t.size() >= LEADERBOARD_SIZE) {
+			if (t.back().score >= score) {
+				return false;
+			}
+			t.pop_back();
+		}
+		t.push_back({ user_id, score });
+		i = t.end() - 1;
+	} else {
+		i->score = score;
+	}
+	while (i != t.begin() && (i - 1)->score < i->score) {
+		std::iter_swap(i, i - 1);
+		--i;
+	}
+	return true;
+}
+
+leaderboards::leaderboards()
+{
+	time_t now = time(nullptr);
+	for (int p = 0; p < LB_PERIODS; ++p) {
+		resets[p] = period_end((leaderboard_period_t)p, now);
+	}
+}
+
+void leaderboards::check_resets()
+{
+	time_t now = time(nullptr);
+	for (int p = 0; p < LB_PERIODS; ++p) {
+		if (now >= resets[p]) {
+			for (auto& g : guilds) {
+				g.second.scores[p].clear();
+				g.second.top[p].clear();
+			}
+			/* Pick up changed names and emojis once a day */
+			if (p == LB_DAY) {
+				users.clear();
+			}
+			resets[p] = period_end((leaderboard_period_t)p, now);
+		}
+	}
+}
+
+static const std::string load_query = "SELECT name, dayscore, weekscore, monthscore, username, discriminator, emojis FROM scores LEFT JOIN trivia_user_cache ON snowflake_id = name LEFT JOIN vw_emojis ON name = user_id WHERE guild_id = ? AND (dayscore > 0 OR weekscore > 0 OR monthscore > 0)";
+
+guild_leaderboard_t& leaderboards::store(uint64_t guild_id, const db::resultset &rs)
+{
+	/* Another thread may have loaded the guild while the lock was released */
+	auto g = guilds.find(guild_id);
+	if (g != guilds.end()) {
+		return g->second;
+	}
+	guild_leaderboard_t& board = guilds[guild_id];
+	for (auto& r : rs) {
+		uint64_t user_id = from_string<uint64_t>(r.at("name"), std::dec);
+		uint64_t score[LB_PERIODS] = {
+			from_string<uint64_t>(r.at("dayscore"), std::dec),
+			from_string<uint64_t>(r.at("weekscore"), std::dec),
+			from_string<uint64_t>(r.at("monthscore"), std::dec)
+		};
+		for (int p = 0; p < LB_PERIODS; ++p) {
+			if (score[p]) {
+				board.scores[p][user_id] = score[p];
+				board.place((leaderboard_period_t)p, user_id, score[p]);
+			}
+		}
+		if (!r.at("username").empty()) {
+			users[user_id] = { r.at("username"), from_string<uint32_t>(r.at("discriminator"), std::dec), r.at("emojis") };
+		}
+	}
+	return board;
+}
+
+guild_leaderboard_t* leaderboards::get(uint64_t guild_id, std::unique_lock<std::mutex> &lock)
+{
+	check_resets();
+	auto g = guilds.find(guild_id);
+	if (g != guilds.end()) {
+		return &g->second;
+	}
+
+	lock.unlock();
+	db::resultset rs = db::query(load_query, {guild_id});
+	bool failed = db::failed();
+	lock.lock();
+
+	/* An empty board would hide the guild's scores until the next reset, so try again next time */
+	return failed ? nullptr : &store(guild_id, rs);
+}
+
+void leaderboards::warm(uint64_t guild_id)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	check_resets();
+	if (guilds.find(guild_id) != guilds.end() || !loading.insert(guild_id).second) {
+		return;
+	}
+	/* Tagged with this object, which the module cancels before it deletes it */
+	db::query_async(load_query, {guild_id}, [this, guild_id](const db::resultset &rs) {
+		bool failed = db::failed();
+		std::lock_guard<std::mutex> l(mutex);
+		loading.erase(guild_id);
+		if (!failed) {
+			store(guild_id, rs);
+		}
+	}, this);
+}
+
+void leaderboards::fetch_user(uint64_t user_id)
+{
+	if (users.find(user_id) != users.end() || !fetching.insert(user_id).second) {
+		return;
+	}
+	/* Tagged with this object, which the module cancels before it deletes it */
+	db::query_ro_async("SELECT username, discriminator, emojis FROM trivia_user_cache LEFT JOIN vw_emojis ON snowflake_id = user_id WHERE snowflake_id = ?", {user_id}, [this, user_id](const db::resultset &rs) {
+		std::lock_guard<std::mutex> l(mutex);
+		fetching.erase(user_id);
+		/* If the user isn't cached yet, leave them out so they are fetched again on their next score */
+		if (rs.size() && !rs[0].at("username").empty()) {
+			users[user_id] = { rs[0].at("username"), from_string<uint32_t>(rs[0].at("discriminator"), std::dec), rs[0].at("emojis") };
+		}
+	}, this);
+}
+
+uint64_t leaderboards::add_score(uint64_t guild_id, uint64_t user_id, uint64_t addition)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	guild_leaderboard_t* board = get(guild_id, lock);
+	if (!board) {
+		/* The score is in the database, and is read with the rest once the guild loads */
+		return 0;
+	}
+	bool listed = false;
+	for (int p = 0; p < LB_PERIODS; ++p) {
+		uint64_t& score = board->scores[p][user_id];
+		score += addition;
+		listed = board->place((leaderboard_period_t)p, user_id, score) || listed;
+	}
+	if (listed) {
+		fetch_user(user_id);
+	}
+	return board->scores[LB_DAY][user_id];
+}
+
+uint64_t leaderboards::get_score(uint64_t guild_id, uint64_t user_id, leaderboard_period_t period)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	guild_leaderboard_t* board = get(guild_id, lock);
+	if (!board) {
+		return 0;
+	}
+	auto i = board->scores[period].find(user_id);
+	return i != board->scores[period].end() ? i->second : 0;
+}
+
+std::vector<leaderboard_entry_t> leaderboards::top(uint64_t guild_id, leaderboard_period_t period)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	guild_leaderboard_t* board = get(guild_id, lock);
+	return board ? board->top[period] : std::vector<leaderboard_entry_t>();
+}
+
+bool leaderboards::get_user(uint64_t user_id, leaderboard_user_t &user)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto i = users.find(user_id);
+	if (i != users.end()) {
+		user = i->second;
+		return true;
+	}
+	return false;
+}
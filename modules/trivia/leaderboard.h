@@ -0,0 +1,111 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <ctime>
+#include <cstdint>
+#include <sporks/database.h>
+
+// Number of entries kept on each leaderboard
+#define LEADERBOARD_SIZE 10
+
+enum leaderboard_period_t {
+	LB_DAY = 0,
+	LB_WEEK = 1,
+	LB_MONTH = 2,
+	LB_PERIODS = 3
+};
+
+struct leaderboard_entry_t
+{
+	uint64_t user_id;
+	uint64_t score;
+};
+
+/* Display details of a user on a leaderboard, from trivia_user_cache and vw_emojis */
+struct leaderboard_user_t
+{
+	std::string username;
+	uint32_t discriminator;
+	std::string emojis;
+};
+
+/* Returns the time the current period ends and scores reset. Periods are in UTC, and weeks start on a Monday */
+time_t period_end(leaderboard_period_t period, time_t now);
+
+/* Scores of one guild for the current day, week and month, with the top LEADERBOARD_SIZE of each kept in order */
+struct guild_leaderboard_t
+{
+	std::unordered_map<uint64_t, uint64_t> scores[LB_PERIODS];
+	std::vector<leaderboard_entry_t> top[LB_PERIODS];
+
+	/* Set a user's score for a period, returns true if they are on the leaderboard. Scores may only increase
+	 * within a period, so an entry can only move up and a user who drops off can never need to come back.
+	 */
+	bool place(leaderboard_period_t period, uint64_t user_id, uint64_t score);
+};
+
+/* Day, week and month scores of every guild that has played on this cluster. A guild's scores are read from
+ * the database in the background when a game starts, or when first needed if that hasn't finished, then kept
+ * up to date by state_t::add_score(), so that leaderboards are shown without touching the database.
+ */
+class leaderboards
+{
+	std::mutex mutex;
+	std::unordered_map<uint64_t, guild_leaderboard_t> guilds;
+	std::unordered_map<uint64_t, leaderboard_user_t> users;
+	std::unordered_set<uint64_t> fetching;
+	/* Guilds being loaded by warm() */
+	std::unordered_set<uint64_t> loading;
+	time_t resets[LB_PERIODS];
+
+	/* Clear any periods which have ended. Caller holds the mutex */
+	void check_resets();
+	/* Add a guild read by the load query, unless it has been added already. Caller holds the mutex */
+	guild_leaderboard_t& store(uint64_t guild_id, const db::resultset &rs);
+	/* Find or load a guild, returns nullptr if it can't be read. Caller holds the lock, which is released while loading */
+	guild_leaderboard_t* get(uint64_t guild_id, std::unique_lock<std::mutex> &lock);
+	/* Fetch a user's display details in the background. Caller holds the mutex */
+	void fetch_user(uint64_t user_id);
+public:
+	leaderboards();
+
+	/* Start loading a guild in the background, if it isn't loaded */
+	void warm(uint64_t guild_id);
+
+	/* Add to a user's score for all periods, returns their new score for the day */
+	uint64_t add_score(uint64_t guild_id, uint64_t user_id, uint64_t addition);
+
+	uint64_t get_score(uint64_t guild_id, uint64_t user_id, leaderboard_period_t period = LB_DAY);
+
+	/* Returns the leaderboard of a guild, highest score first */
+	std::vector<leaderboard_entry_t> top(uint64_t guild_id, leaderboard_period_t period = LB_DAY);
+
+	/* Get the display details of a user, returns false if they are not known yet */
+	bool get_user(uint64_t user_id, leaderboard_user_t &user);
+};
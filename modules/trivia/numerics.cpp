@@ -72,34 +72,35 @@ std::string TriviaModule::tidy_num(std::string num)
 
 std::string TriviaModule::conv_num(std::string datain, const guild_settings_t &settings)
 {
-	std::map<std::string, int> nn= {
-		{ _("ONE", settings), 1 },
-		{ _("TWO", settings), 2 },
-		{ _("THREE", settings), 3 },
-		{ _("FOUR", settings), 4 },
-		{ _("FIVE", settings), 5 },
-		{ _("SIX", settings), 6 },
-		{ _("SEVEN", settings), 7 },
-		{ _("EIGHT", settings), 8 },
-		{ _("NINE", settings), 9 },
-		{ _("TEN", settings), 10 },
-		{ _("ELEVEN", settings), 11 },
-		{ _("TWELVE", settings), 12 },
-		{ _("THIRTEEN", settings), 13 },
-		{ _("FOURTEEN", settings), 14 },
-		{ _("FIFTEEN", settings), 15 },
-		{ _("SIXTEEN", settings), 16 },
-		{ _("SEVENTEEN", settings), 17 },
-		{ _("EIGHTEEN", settings), 18 },
-		{ _("NINETEEN", settings), 19 },
-		{ _("TWENTY", settings), 20 },
-		{ _("THIRTY", settings), 30 },
-		{ _("FOURTY", settings), 40 },
-		{ _("FIFTY", settings), 50 },
-		{ _("SIXTY", settings), 60 },
-		{ _("SEVENTY", settings), 70 },
-		{ _("EIGHTY", settings), 80 },
-		{ _("NINETY", settings), 90 }
+	/* Views into the language table, so building this map copies no strings */
+	std::map<std::string_view, int> nn= {
+		{ langview("ONE", settings), 1 },
+		{ langview("TWO", settings), 2 },
+		{ langview("THREE", settings), 3 },
+		{ langview("FOUR", settings), 4 },
+		{ langview("FIVE", settings), 5 },
+		{ langview("SIX", settings), 6 },
+		{ langview("SEVEN", settings), 7 },
+		{ langview("EIGHT", settings), 8 },
+		{ langview("NINE", settings), 9 },
+		{ langview("TEN", settings), 10 },
+		{ langview("ELEVEN", settings), 11 },
+		{ langview("TWELVE", settings), 12 },
+		{ langview("THIRTEEN", settings), 13 },
+		{ langview("FOURTEEN", settings), 14 },
+		{ langview("FIFTEEN", settings), 15 },
+		{ langview("SIXTEEN", settings), 16 },
+		{ langview("SEVENTEEN", settings), 17 },
+		{ langview("EIGHTEEN", settings), 18 },
+		{ langview("NINETEEN", settings), 19 },
+		{ langview("TWENTY", settings), 20 },
+		{ langview("THIRTY", settings), 30 },
+		{ langview("FOURTY", settings), 40 },
+		{ langview("FIFTY", settings), 50 },
+		{ langview("SIXTY", settings), 60 },
+		{ langview("SEVENTY", settings), 70 },
+		{ langview("EIGHTY", settings), 80 },
+		{ langview("NINETY", settings), 90 }
 	};
 	if (datain.empty()) {
 		datain = _("ZERO", settings);
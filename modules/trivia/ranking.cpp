@@ -0,0 +1,156 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <stdexcept>
+#include <unistd.h>
+#include <fmt/format.h>
+#include <sporks/database.h>
+#include <sporks/stringops.h>
+#include "ranking.h"
+#include "trivia.h"
+#include "time.h"
+
+global_ranks::global_ranks() : loaded(false)
+{
+	time_t now = time(nullptr);
+	for (int p = 0; p < LB_PERIODS; ++p) {
+		resets[p] = period_end((leaderboard_period_t)p, now);
+	}
+}
+
+void global_ranks::check_resets()
+{
+	time_t now = time(nullptr);
+	for (int p = 0; p < LB_PERIODS; ++p) {
+		if (now >= resets[p]) {
+			ranks[p].clear();
+			resets[p] = period_end((leaderboard_period_t)p, now);
+		}
+	}
+}
+
+bool global_ranks::ready()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return loaded;
+}
+
+void global_ranks::add_score(uint64_t user_id, uint64_t addition)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	check_resets();
+	for (auto& r : ranks) {
+		r.add(user_id, addition);
+	}
+}
+
+uint64_t global_ranks::get_score(uint64_t user_id, rank_period_t period)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	check_resets();
+	return ranks[period].get(user_id);
+}
+
+uint64_t global_ranks::rank(uint64_t user_id, rank_period_t period)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	check_resets();
+	return ranks[period].rank(user_id);
+}
+
+std::vector<rank_entry_t> global_ranks::page(uint64_t page, rank_period_t period)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	check_resets();
+	return page ? ranks[period].range((page - 1) * RANK_PAGE_SIZE, RANK_PAGE_SIZE) : std::vector<rank_entry_t>();
+}
+
+size_t global_ranks::size(rank_period_t period)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	check_resets();
+	return ranks[period].size();
+}
+
+size_t global_ranks::rebuild(const bool &cancel)
+{
+	/* A failed query reads as no rows, which would end the read early, so the total is checked afterwards */
+	db::resultset count = db::query_ro("SELECT COUNT(*) AS total FROM global_scores", {});
+	if (count.empty()) {
+		throw std::runtime_error("Can't count global_scores, keeping the current rank index");
+	}
+	size_t expected = from_string<size_t>(count[0]["total"], std::dec);
+
+	score_rank fresh[RANK_PERIODS];
+	size_t rows = 0;
+	std::string last = "0";
+	db::resultset rs;
+	do {
+		/* Read in key order, so each chunk starts where the last one ended */
+		rs = db::query_ro("SELECT name, score, dayscore, weekscore, monthscore FROM global_scores WHERE name > ? ORDER BY name LIMIT ?", {from_string<uint64_t>(last, std::dec), RANK_REBUILD_CHUNK});
+		for (auto& r : rs) {
+			uint64_t user_id = from_string<uint64_t>(r["name"], std::dec);
+			fresh[RANK_DAY].set(user_id, from_string<uint64_t>(r["dayscore"], std::dec));
+			fresh[RANK_WEEK].set(user_id, from_string<uint64_t>(r["weekscore"], std::dec));
+			fresh[RANK_MONTH].set(user_id, from_string<uint64_t>(r["monthscore"], std::dec));
+			fresh[RANK_LIFETIME].set(user_id, from_string<uint64_t>(r["score"], std::dec));
+			last = r["name"];
+		}
+		rows += rs.size();
+	} while (rs.size() == RANK_REBUILD_CHUNK && !cancel);
+
+	if (cancel) {
+		return rows;
+	}
+	/* Players may be added or removed while reading, so allow a little either way */
+	if (rows + expected / 100 < expected) {
+		throw std::runtime_error(fmt::format("Rank index rebuild read {} of {} players, keeping the current rank index", rows, expected));
+	}
+	std::lock_guard<std::mutex> lock(mutex);
+	for (int p = 0; p < RANK_PERIODS; ++p) {
+		std::swap(ranks[p], fresh[p]);
+	}
+	loaded = true;
+	check_resets();
+	return rows;
+}
+
+void TriviaModule::WatchRanks()
+{
+	uint32_t interval = from_string<uint32_t>(Bot::GetConfig("rankrebuild", std::to_string(RANK_REBUILD_SECS)), std::dec);
+	while (!terminating) {
+		try {
+			double start = time_f();
+			size_t rows = ranks->rebuild(terminating);
+			if (!terminating) {
+				bot->core->log(dpp::ll_info, fmt::format("Rebuilt global rank index of {} players in {:.3f} seconds", rows, time_f() - start));
+			}
+		}
+		catch (std::exception &e) {
+			bot->core->log(dpp::ll_error, fmt::format("Exception in WatchRanks: {}", e.what()));
+		}
+		for (uint32_t i = 0; i < interval && !terminating; ++i) {
+			sleep(1);
+		}
+	}
+}
@@ -0,0 +1,137 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <ctime>
+#include <cstdint>
+#include "leaderboard.h"
+
+// Number of players shown on each page of the global leaderboard
+#define RANK_PAGE_SIZE 10
+
+// Number of global_scores rows read per query when rebuilding the rank index
+#define RANK_REBUILD_CHUNK 100000
+
+enum rank_period_t {
+	RANK_DAY = LB_DAY,
+	RANK_WEEK = LB_WEEK,
+	RANK_MONTH = LB_MONTH,
+	RANK_LIFETIME = LB_PERIODS,
+	RANK_PERIODS
+};
+
+struct rank_entry_t
+{
+	uint64_t user_id;
+	uint64_t score;
+	/* Players on the same score share a rank */
+	uint64_t rank;
+};
+
+/* An order statistic index of player scores for one period. A Fenwick tree over score values counts the
+ * players on each score, so a player's rank and the score at any position are found in O(log max score).
+ * Players with no score are not indexed.
+ */
+class score_rank
+{
+	struct player_t
+	{
+		uint64_t score;
+		/* Position in the score's bucket */
+		size_t slot;
+	};
+	/* Fenwick tree of the number of players on each score, tree[0] is unused */
+	std::vector<uint32_t> tree;
+	/* Players on each score, unordered */
+	std::unordered_map<uint64_t, std::vector<uint64_t>> buckets;
+	std::unordered_map<uint64_t, player_t> players;
+
+	void adjust(uint64_t score, int32_t delta);
+	/* Number of players on a score from 1 to the given score */
+	uint64_t prefix(uint64_t score) const;
+	/* Lowest score whose prefix() is at least count */
+	uint64_t lower_bound(uint64_t count) const;
+	void insert(uint64_t user_id, uint64_t score);
+	void remove(uint64_t user_id);
+public:
+	void set(uint64_t user_id, uint64_t score);
+	void add(uint64_t user_id, uint64_t addition);
+	uint64_t get(uint64_t user_id) const;
+
+	/* Returns the rank of a player starting at 1, or 0 if they have no score */
+	uint64_t rank(uint64_t user_id) const;
+
+	/* Returns up to count players from the given zero based position, highest score first.
+	 * Players on the same score are ordered by id.
+	 */
+	std::vector<rank_entry_t> range(uint64_t first, size_t count) const;
+
+	size_t size() const;
+	void clear();
+};
+
+/* Lifetime, monthly, weekly and daily global ranks of every player. The index is loaded from global_scores
+ * by rebuild(), and kept up to date between rebuilds from the score write path.
+ *
+ * Every cluster holds its own copy. Measured with buildtools/rankbench at 10 million players, it uses about
+ * 760MB, and a rebuild peaks at about 1.6GB as it holds a second copy until the swap.
+ */
+class global_ranks
+{
+	std::mutex mutex;
+	score_rank ranks[RANK_PERIODS];
+	time_t resets[LB_PERIODS];
+	bool loaded;
+
+	/* Clear any periods which have ended. Caller holds the mutex */
+	void check_resets();
+public:
+	global_ranks();
+
+	/* False until the first rebuild() completes */
+	bool ready();
+
+	/* Add to a player's score for all periods */
+	void add_score(uint64_t user_id, uint64_t addition);
+
+	uint64_t get_score(uint64_t user_id, rank_period_t period);
+
+	/* Returns the rank of a player starting at 1, or 0 if they have no score */
+	uint64_t rank(uint64_t user_id, rank_period_t period);
+
+	/* Returns a page of RANK_PAGE_SIZE players, the first page is page 1 */
+	std::vector<rank_entry_t> page(uint64_t page, rank_period_t period);
+
+	size_t size(rank_period_t period);
+
+	/* Load the index from global_scores. The new index is built without holding the lock and then swapped
+	 * in, so scores added while it runs are only counted once the next rebuild reads them back. Returns
+	 * the number of players read, the old index is kept if cancel is set part way through. Throws
+	 * std::runtime_error, keeping the old index, if fewer players were read than global_scores holds.
+	 */
+	size_t rebuild(const bool &cancel);
+};
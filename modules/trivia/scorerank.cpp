@@ -0,0 +1,163 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <algorithm>
+#include "ranking.h"
+
+void score_rank::adjust(uint64_t score, int32_t delta)
+{
+	if (score >= tree.size()) {
+		/* Grow the tree, rebuilding it in linear time from the bucket sizes */
+		size_t newsize = std::max<size_t>(score + 1, tree.size() * 2);
+		tree.assign(newsize, 0);
+		for (auto& b : buckets) {
+			tree[b.first] = b.second.size();
+		}
+		for (size_t i = 1; i < newsize; ++i) {
+			size_t parent = i + (i & -i);
+			if (parent < newsize) {
+				tree[parent] += tree[i];
+			}
+		}
+		/* The bucket already reflects this change */
+		return;
+	}
+	for (size_t i = score; i < tree.size(); i += (i & -i)) {
+		tree[i] += delta;
+	}
+}
+
+uint64_t score_rank::prefix(uint64_t score) const
+{
+	uint64_t total = 0;
+	if (tree.empty()) {
+		return 0;
+	}
+	for (size_t i = std::min<size_t>(score, tree.size() - 1); i > 0; i -= (i & -i)) {
+		total += tree[i];
+	}
+	return total;
+}
+
+uint64_t score_rank::lower_bound(uint64_t count) const
+{
+	size_t pos = 0;
+	size_t step = 1;
+	while (step * 2 < tree.size()) {
+		step *= 2;
+	}
+	for (; step; step /= 2) {
+		if (pos + step < tree.size() && tree[pos + step] < count) {
+			pos += step;
+			count -= tree[pos];
+		}
+	}
+	return pos + 1;
+}
+
+void score_rank::insert(uint64_t user_id, uint64_t score)
+{
+	std::vector<uint64_t>& bucket = buckets[score];
+	players[user_id] = { score, bucket.size() };
+	bucket.push_back(user_id);
+	adjust(score, 1);
+}
+
+void score_rank::remove(uint64_t user_id)
+{
+	auto p = players.find(user_id);
+	if (p == players.end()) {
+		return;
+	}
+	uint64_t score = p->second.score;
+	std::vector<uint64_t>& bucket = buckets[score];
+	/* Move the last player of the bucket into the freed slot */
+	bucket[p->second.slot] = bucket.back();
+	players[bucket.back()].slot = p->second.slot;
+	bucket.pop_back();
+	if (bucket.empty()) {
+		buckets.erase(score);
+	}
+	players.erase(user_id);
+	adjust(score, -1);
+}
+
+void score_rank::set(uint64_t user_id, uint64_t score)
+{
+	remove(user_id);
+	if (score) {
+		insert(user_id, score);
+	}
+}
+
+void score_rank::add(uint64_t user_id, uint64_t addition)
+{
+	set(user_id, get(user_id) + addition);
+}
+
+uint64_t score_rank::get(uint64_t user_id) const
+{
+	auto p = players.find(user_id);
+	return p != players.end() ? p->second.score : 0;
+}
+
+uint64_t score_rank::rank(uint64_t user_id) const
+{
+	auto p = players.find(user_id);
+	if (p == players.end()) {
+		return 0;
+	}
+	return players.size() - prefix(p->second.score) + 1;
+}
+
+std::vector<rank_entry_t> score_rank::range(uint64_t first, size_t count) const
+{
+	std::vector<rank_entry_t> entries;
+	uint64_t total = players.size();
+	while (entries.size() < count && first < total) {
+		/* The score at this position, and how many players are above it */
+		uint64_t score = lower_bound(total - first);
+		uint64_t above = total - prefix(score);
+		const std::vector<uint64_t>& bucket = buckets.at(score);
+		size_t skip = first - above;
+		size_t take = std::min(count - entries.size(), bucket.size() - skip);
+		std::vector<uint64_t> ids(skip + take);
+		std::partial_sort_copy(bucket.begin(), bucket.end(), ids.begin(), ids.end());
+		for (size_t i = skip; i < ids.size(); ++i) {
+			entries.push_back({ ids[i], score, above + 1 });
+		}
+		first += take;
+	}
+	return entries;
+}
+
+size_t score_rank::size() const
+{
+	return players.size();
+}
+
+void score_rank::clear()
+{
+	tree.clear();
+	buckets.clear();
+	players.clear();
+}
@@ -24,6 +24,7 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 
 class guild_settings_t
 {
@@ -51,3 +52,8 @@ class guild_settings_t
 	guild_settings_t(const guild_settings_t&) = default;
 	guild_settings_t& operator=(const guild_settings_t&) = default;
 };
+
+/* Guild settings are shared as immutable snapshots. To change settings, copy
+ * the snapshot, change the copy and publish it with TriviaModule::UpdateGuildSettings().
+ */
+typedef std::shared_ptr<const guild_settings_t> guild_settings_ptr;
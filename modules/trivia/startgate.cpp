@@ -0,0 +1,123 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <algorithm>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fmt/format.h>
+#include <dpp/nlohmann/json.hpp>
+#include <sporks/database.h>
+#include <sporks/stringops.h>
+#include "startgate.h"
+#include "trivia.h"
+
+using json = nlohmann::json;
+
+start_gate::start_gate() : whitelists(std::make_shared<const whitelist_map_t>()), blocklist(std::make_shared<const std::vector<uint64_t>>()), config_mtime(0)
+{
+}
+
+std::vector<uint64_t> start_gate::whitelist(uint64_t guild_id) const
+{
+	std::shared_ptr<const whitelist_map_t> w = std::atomic_load(&whitelists);
+	auto i = w->find(guild_id);
+	return i != w->end() ? i->second : std::vector<uint64_t>();
+}
+
+bool start_gate::blocked(uint64_t id) const
+{
+	std::shared_ptr<const std::vector<uint64_t>> b = std::atomic_load(&blocklist);
+	return std::binary_search(b->begin(), b->end(), id);
+}
+
+time_t start_gate::claim_cooldown(uint64_t guild_id, time_t period)
+{
+	time_t now = time(NULL);
+	{
+		std::lock_guard<std::mutex> lock(cooldown_mutex);
+		auto i = cooldowns.find(guild_id);
+		if (i != cooldowns.end() && now - i->second < period) {
+			return period - (now - i->second);
+		}
+		cooldowns[guild_id] = now;
+	}
+	db::backgroundquery("INSERT INTO insane_cooldown (guild_id, last_started) VALUES(?, ?) ON DUPLICATE KEY UPDATE last_started = ?", {guild_id, now, now});
+	return 0;
+}
+
+void start_gate::reload_whitelists()
+{
+	db::resultset rs = db::query("SELECT guild_id, channel_id FROM channel_whitelist", {});
+	whitelist_map_t w;
+	for (auto& r : rs) {
+		w[from_string<uint64_t>(r["guild_id"], std::dec)].push_back(from_string<uint64_t>(r["channel_id"], std::dec));
+	}
+	std::atomic_store(&whitelists, std::shared_ptr<const whitelist_map_t>(std::make_shared<const whitelist_map_t>(std::move(w))));
+}
+
+void start_gate::reload_config(const std::string &filename)
+{
+	struct stat st;
+	if (stat(filename.c_str(), &st) != 0 || st.st_mtime == config_mtime) {
+		return;
+	}
+	json document;
+	std::ifstream configfile(filename);
+	configfile >> document;
+	std::vector<uint64_t> list;
+	auto shitlist = document.find("shitlist");
+	if (shitlist != document.end() && shitlist->is_array()) {
+		for (auto& entry : *shitlist) {
+			/* Ids may be given as numbers or as strings */
+			list.push_back(entry.is_string() ? from_string<uint64_t>(entry.get<std::string>(), std::dec) : entry.get<uint64_t>());
+		}
+	}
+	std::sort(list.begin(), list.end());
+	std::atomic_store(&blocklist, std::shared_ptr<const std::vector<uint64_t>>(std::make_shared<const std::vector<uint64_t>>(std::move(list))));
+	config_mtime = st.st_mtime;
+}
+
+void start_gate::load_cooldowns(time_t period)
+{
+	db::resultset rs = db::query("SELECT guild_id, last_started FROM insane_cooldown WHERE last_started > UNIX_TIMESTAMP() - ?", {period});
+	std::lock_guard<std::mutex> lock(cooldown_mutex);
+	for (auto& r : rs) {
+		cooldowns[from_string<uint64_t>(r["guild_id"], std::dec)] = from_string<time_t>(r["last_started"], std::dec);
+	}
+}
+
+void TriviaModule::WatchStartGate()
+{
+	while (!terminating) {
+		for (int i = 0; i < START_GATE_REFRESH_SECS && !terminating; ++i) {
+			sleep(1);
+		}
+		try {
+			gate->reload_config("../config.json");
+			gate->reload_whitelists();
+		}
+		catch (std::exception &e) {
+			bot->core->log(dpp::ll_error, fmt::format("Exception in WatchStartGate: {}", e.what()));
+		}
+	}
+}
@@ -0,0 +1,72 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <ctime>
+#include <cstdint>
+
+/* Everything /start checks before a game can begin, held in memory so that starting a game reads
+ * nothing from the database or the disk. The channel whitelists and the config.json blocklist are
+ * immutable snapshots swapped in by the watcher thread, which is the only caller of reload_whitelists()
+ * and reload_config(). Quickfire cooldowns are written through to insane_cooldown as they are claimed.
+ */
+class start_gate
+{
+	typedef std::unordered_map<uint64_t, std::vector<uint64_t>> whitelist_map_t;
+
+	std::shared_ptr<const whitelist_map_t> whitelists;
+	std::shared_ptr<const std::vector<uint64_t>> blocklist;
+	/* Modification time of the config file when it was last read */
+	time_t config_mtime;
+
+	std::mutex cooldown_mutex;
+	/* Guild id to the time its last cooldown began */
+	std::unordered_map<uint64_t, time_t> cooldowns;
+public:
+	start_gate();
+
+	/* Returns the channels games may be started in for a guild. Empty if the guild has no whitelist */
+	std::vector<uint64_t> whitelist(uint64_t guild_id) const;
+
+	/* Returns true if the id is on the shitlist in config.json */
+	bool blocked(uint64_t id) const;
+
+	/* Starts a cooldown for the guild if none is running, and returns 0. If one is running,
+	 * returns the number of seconds left on it instead.
+	 */
+	time_t claim_cooldown(uint64_t guild_id, time_t period);
+
+	/* Load every channel whitelist */
+	void reload_whitelists();
+
+	/* Read the shitlist from the config file, if it has changed since it was last read */
+	void reload_config(const std::string &filename);
+
+	/* Load the cooldowns still running, at startup */
+	void load_cooldowns(time_t period);
+};
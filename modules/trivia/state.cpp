@@ -39,8 +39,6 @@
 #include "piglatin.h"
 #include "time.h"
 
-std::unordered_map<uint64_t, bool> banlist;
-
 in_msg::in_msg(const std::string &m, uint64_t author, bool mention, const std::string &_username, dpp::user u, dpp::guild_member gm) : msg(m), author_id(author), mentions_bot(mention), username(_username), user(u), member(gm)
 {
 }
@@ -74,42 +72,18 @@ state_t::state_t(TriviaModule* _creator, uint32_t questions, uint32_t currstreak
 {
 	creator->GetBot()->core->log(dpp::ll_debug, fmt::format("state_t::state_t()"));
 	insane.clear();
-	db::resultset rs = db::query("SELECT name, dayscore FROM scores WHERE guild_id = ? AND dayscore > 0", {guild_id});
-	if (rs.size()) {
-		for (auto s = rs.begin(); s != rs.end(); ++s) {
-			scores[from_string<uint64_t>((*s)["name"], std::dec)] = from_string<uint64_t>((*s)["dayscore"], std::dec);
-		}
-		creator->GetBot()->core->log(dpp::ll_debug, fmt::format("Cached {} guild scores for game on channel {}", rs.size(), channel_id));
-	}
-	/* This doesnt need to be done every time */
-	db::resultset rs2 = db::query("SELECT * FROM bans WHERE play_ban = 1", {});
-	if (rs2.size()) {
-		banlist.clear();
-		for (auto s = rs2.begin(); s != rs2.end(); ++s) {
-			banlist[from_string<uint64_t>((*s)["snowflake_id"], std::dec)] = true;
-		}
-	}
+	/* Read the guild's scores now, rather than on the first answer */
+	creator->leaderboard->warm(guild_id);
 }
 
 uint64_t state_t::get_score(dpp::snowflake uid)
 {
-	auto i = scores.find(uid);
-	if (i != scores.end()) {
-		return i->second;
-	} else {
-		return 0;
-	}
-}
-
-void state_t::set_score(dpp::snowflake uid, uint64_t score)
-{
-	scores[uid] = score;
+	return creator->leaderboard->get_score(guild_id, uid);
 }
 
 void state_t::add_score(dpp::snowflake uid, uint64_t addition)
 {
-	uint64_t oldscore = get_score(uid);
-	set_score(uid, oldscore + addition);
+	creator->leaderboard->add_score(guild_id, uid, addition);
 }
 
 void state_t::clear_insane_stats()
@@ -128,7 +102,7 @@ void state_t::add_insane_stats(dpp::snowflake uid)
 }
 
 
-std::string state_t::_(const std::string &k, const guild_settings_t& settings)
+std::string state_t::_(lang_key k, const guild_settings_t& settings)
 {
 	return creator->_(k, settings);
 }
@@ -196,7 +170,7 @@ void state_t::record_activity(uint64_t user_id)
 
 bool state_t::user_banned(uint64_t user_id)
 {
-	return (banlist.find(user_id) != banlist.end());
+	return creator->bans->is_banned(user_id);
 }
 
 /* Handle inbound message */
@@ -341,13 +315,8 @@ void state_t::handle_message(const in_msg& m, const guild_settings_t& settings)
 					thumbnail = "https://triviabot.co.uk/images/coin.gif";
 					/* TODO: Award 100 + rand coins */
 					uint32_t coins = 100 + creator->random(0, 50);
-					db::resultset rs = db::query("SELECT * FROM coins WHERE user_id = ?", {m.author_id});
-					db::backgroundquery("INSERT INTO coins (user_id, balance) VALUES(?, ?) ON DUPLICATE KEY UPDATE balance = balance + ?", {m.author_id, coins});
-					uint64_t current = 0;
-					if (rs.size()) {
-						current = from_string<uint64_t>(rs[0]["balance"], std::dec);
-					}
-					ans_message.append("\n\n**").append(fmt::format(_(std::string("COIN_DROP_") + std::to_string(creator->random(1, 4)), settings), m.username, coins, current + coins)).append("**");
+					uint64_t current = creator->coins->drop(m.author_id, coins);
+					ans_message.append("\n\n**").append(fmt::format(_(std::string("COIN_DROP_") + std::to_string(creator->random(1, 4)), settings), m.username, coins, current)).append("**");
 
 				}
 
@@ -375,7 +344,8 @@ void state_t::handle_message(const in_msg& m, const guild_settings_t& settings)
  */
 void state_t::tick()
 {
-	guild_settings_t settings = creator->GetGuildSettings(guild_id);
+	guild_settings_ptr settings_ptr = creator->GetGuildSettings(guild_id);
+	const guild_settings_t& settings = *settings_ptr;
 	if (!is_valid()) {
 		log_game_end(guild_id, channel_id);
 		terminating = true;
@@ -650,10 +620,15 @@ void state_t::do_insane_board(const guild_settings_t& settings) {
 	for (auto s = insane_round_stats.begin(); s != insane_round_stats.end(); ++s) {
 		ordered.insert(std::make_pair(s->second, s->first));
 	}
+	std::vector<uint64_t> ids;
+	for (auto& s : insane_round_stats) {
+		ids.push_back(s.first);
+	}
+	std::unordered_map<uint64_t, user_card_t> info = creator->cards->get(ids);
 	for (std::multimap<uint64_t, dpp::snowflake>::reverse_iterator sc = ordered.rbegin(); sc != ordered.rend(); ++sc) {
-		db::resultset info = db::query("SELECT username, discriminator, get_emojis(trivia_user_cache.snowflake_id) as emojis FROM trivia_user_cache WHERE snowflake_id = ?", {sc->second});
-		if (info.size()) {
-			desc += fmt::format("**#{0}** `{1}#{2:04d}` (*{3}*) {4}\n", i, info[0]["username"], from_string<uint32_t>(info[0]["discriminator"], std::dec), Comma(sc->first), info[0]["emojis"]);
+		user_card_t& card = info[sc->second];
+		if (card.found) {
+			desc += fmt::format("**#{0}** `{1}#{2:04d}` (*{3}*) {4}\n", i, card.username, card.discriminator, Comma(sc->first), card.emojis);
 		}
 		i++;
 	}
@@ -685,9 +660,8 @@ void state_t::build_question_cache(const guild_settings_t& settings)
 {
 	double start = dpp::utility::time_f();
 	creator->GetBot()->core->log(dpp::ll_debug, fmt::format("Build question cache start: G:{} C:{}", guild_id, channel_id));
-	for (size_t i = 0; i < shuffle_list.size(); ++i) {
-		question_cache.emplace_back(question_t::fetch(from_string<uint64_t>(shuffle_list[i], std::dec), guild_id, settings));
-	}
+	std::vector<question_t> questions = question_t::fetch_many(shuffle_list, guild_id, settings);
+	question_cache.insert(question_cache.end(), questions.begin(), questions.end());
 	creator->GetBot()->core->log(dpp::ll_debug, fmt::format("Build question cache end in {:.04f} secs: G:{} C:{}", dpp::utility::time_f() - start, guild_id, channel_id));
 }
 
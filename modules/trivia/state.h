@@ -4,6 +4,8 @@
 #include <map>
 #include <thread>
 #include <deque>
+#include "lang.h"
+#include <dpp/nlohmann/json.hpp>
 
 enum trivia_state_t
 {
@@ -50,12 +52,17 @@ struct question_t
 		const std::string &_lastcorrect, double _record_time, const std::string &_shuffle1, const std::string &_shuffle2, const std::string &_question_image, const std::string &_answer_image);
 
 	static question_t fetch(uint64_t id, uint64_t guild_id, const class guild_settings_t &settings);
+	static std::vector<question_t> fetch_many(const std::vector<std::string> &ids, uint64_t guild_id, const class guild_settings_t &settings);
+
+	/* Serialisation for handing games over across a module reload */
+	explicit question_t(const nlohmann::json &j);
+	nlohmann::json to_json() const;
 };
 
 class state_t
 {
 	class TriviaModule* creator;
-	std::string _(const std::string &k, const class guild_settings_t& settings);
+	std::string _(lang_key k, const class guild_settings_t& settings);
 	uint32_t get_activity();
 	void record_activity(uint64_t user_id);
 	bool should_drop_coin();
@@ -85,13 +92,15 @@ class state_t
 	bool hintless;
 	std::map<std::string, bool> insane;
 	std::map<uint64_t, time_t> activity;
-	std::unordered_map<dpp::snowflake, uint64_t> scores;
 	std::unordered_map<dpp::snowflake, uint32_t> insane_round_stats;
 	std::vector<question_t> question_cache;
 
 	state_t(const state_t &) = default;
 	state_t();
 	state_t(class TriviaModule* _creator, uint32_t questions, uint32_t currstreak, uint64_t lastanswered, uint32_t question_index, uint32_t _interval, uint64_t channel_id, bool hintless, const std::vector<std::string> &shuffle_list, trivia_state_t startstate,  uint64_t guild_id);
+	/* Restore a game handed over by a previous instance of the module, see TriviaModule::AdoptGames() */
+	state_t(class TriviaModule* _creator, const nlohmann::json &j);
+	nlohmann::json to_json() const;
 	~state_t();
 	void tick();
 	void build_question_cache(const guild_settings_t& settings);
@@ -108,7 +117,6 @@ class state_t
 	void StopGame(const guild_settings_t &settings);
 	bool is_insane_round(const guild_settings_t& settings);
 	uint64_t get_score(dpp::snowflake uid);
-	void set_score(dpp::snowflake uid, uint64_t score);
 	void add_score(dpp::snowflake uid, uint64_t addition);
 	void clear_insane_stats();
 	void add_insane_stats(dpp::snowflake uid);
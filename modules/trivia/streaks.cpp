@@ -0,0 +1,148 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <sporks/database.h>
+#include <sporks/stringops.h>
+#include "streaks.h"
+#include "webrequest.h"
+
+streak_board_t::streak_board_t() : topstreaker(0), bigstreak(0)
+{
+}
+
+bool streak_board_t::set(uint64_t user_id, uint32_t streak)
+{
+	uint32_t& pb = best[user_id];
+	if (streak <= pb) {
+		return false;
+	}
+	pb = streak;
+	if (streak > bigstreak) {
+		topstreaker = user_id;
+		bigstreak = streak;
+	}
+	return true;
+}
+
+/* Fill in a streak_t, with the top streak as 9999999 if nobody has one so that it can't be beaten */
+static streak_t make_streak(const streak_board_t &board, uint64_t user_id)
+{
+	streak_t s;
+	auto pb = board.best.find(user_id);
+	s.personalbest = (pb != board.best.end() ? pb->second : 0);
+	s.topstreaker = board.topstreaker;
+	s.bigstreak = (board.bigstreak ? board.bigstreak : 9999999);
+	return s;
+}
+
+streak_index::streak_index() : global_expires(0)
+{
+}
+
+streak_board_t& streak_index::get_guild(uint64_t guild_id, std::unique_lock<std::mutex> &lock)
+{
+	auto g = guilds.find(guild_id);
+	if (g != guilds.end()) {
+		return g->second;
+	}
+
+	lock.unlock();
+	db::resultset rs = db::query("SELECT nick, streak FROM streaks WHERE guild_id = '?'", {guild_id});
+	lock.lock();
+
+	/* Another thread may have loaded the guild while the lock was released */
+	g = guilds.find(guild_id);
+	if (g != guilds.end()) {
+		return g->second;
+	}
+	streak_board_t& board = guilds[guild_id];
+	for (auto& r : rs) {
+		board.set(from_string<uint64_t>(r["nick"], std::dec), from_string<uint32_t>(r["streak"], std::dec));
+	}
+	return board;
+}
+
+void streak_index::load_global(uint64_t user_id, std::unique_lock<std::mutex> &lock)
+{
+	time_t now = time(nullptr);
+	bool top = (now >= global_expires);
+	auto expires = best_expires.find(user_id);
+	bool pb = (expires == best_expires.end() || now >= expires->second);
+	if (!top && !pb) {
+		return;
+	}
+
+	lock.unlock();
+	db::resultset toprs = top ? db::query("SELECT nick, streak FROM global_streaks ORDER BY streak DESC LIMIT 1", {}) : db::resultset();
+	db::resultset pbrs = pb ? db::query("SELECT streak FROM global_streaks WHERE nick='?'", {user_id}) : db::resultset();
+	lock.lock();
+
+	if (top) {
+		global_expires = now + GLOBAL_STREAK_TTL;
+		/* Keep a higher streak set here which may not have been written yet */
+		if (toprs.size() && from_string<uint32_t>(toprs[0]["streak"], std::dec) > global.bigstreak) {
+			global.topstreaker = from_string<uint64_t>(toprs[0]["nick"], std::dec);
+			global.bigstreak = from_string<uint32_t>(toprs[0]["streak"], std::dec);
+		}
+	}
+	if (pb) {
+		best_expires[user_id] = now + GLOBAL_STREAK_TTL;
+		/* As above, set() keeps a higher best set here */
+		global.set(user_id, pbrs.size() ? from_string<uint32_t>(pbrs[0]["streak"], std::dec) : 0);
+	}
+}
+
+streak_t streak_index::get(uint64_t user_id, uint64_t guild_id)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return make_streak(get_guild(guild_id, lock), user_id);
+}
+
+streak_t streak_index::get(uint64_t user_id)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	load_global(user_id, lock);
+	return make_streak(global, user_id);
+}
+
+void streak_index::set(uint64_t user_id, uint64_t guild_id, uint32_t streak)
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (!get_guild(guild_id, lock).set(user_id, streak)) {
+			return;
+		}
+	}
+	db::backgroundquery("INSERT INTO streaks (nick, guild_id, streak) VALUES('?','?','?') ON DUPLICATE KEY UPDATE streak = GREATEST(streak, ?)", {user_id, guild_id, streak, streak});
+}
+
+void streak_index::set(uint64_t user_id, uint32_t streak)
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		load_global(user_id, lock);
+		if (!global.set(user_id, streak)) {
+			return;
+		}
+	}
+	db::backgroundquery("INSERT INTO global_streaks (nick, streak) VALUES('?','?') ON DUPLICATE KEY UPDATE streak = GREATEST(streak, ?)", {user_id, streak, streak});
+}
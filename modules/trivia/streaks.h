@@ -0,0 +1,78 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <ctime>
+#include <cstdint>
+
+// Number of seconds the global top streak and global personal bests are cached, they can be beaten on other clusters
+#define GLOBAL_STREAK_TTL 60
+
+/* Best streaks of the players on one guild, or globally */
+struct streak_board_t
+{
+	uint64_t topstreaker;
+	uint32_t bigstreak;
+	/* Personal bests, zero if the player has none */
+	std::unordered_map<uint64_t, uint32_t> best;
+
+	streak_board_t();
+	/* Record a streak, returns false if it is not a personal best */
+	bool set(uint64_t user_id, uint32_t streak);
+};
+
+/* Personal best streaks, and the top streak, of each guild and globally. A guild's streaks are read from the
+ * streaks table in one query the first time it is needed. Global personal bests are read one player at a
+ * time from global_streaks as they are needed, as that table covers every player, and read again once
+ * they expire. Changes are written through to the database in the background, never lowering a streak
+ * another cluster has written.
+ */
+class streak_index
+{
+	std::mutex mutex;
+	std::unordered_map<uint64_t, streak_board_t> guilds;
+	streak_board_t global;
+	time_t global_expires;
+	/* When each cached global personal best must be read again */
+	std::unordered_map<uint64_t, time_t> best_expires;
+
+	/* Find or load a guild. Caller holds the lock, which is released while loading */
+	streak_board_t& get_guild(uint64_t guild_id, std::unique_lock<std::mutex> &lock);
+	/* Load the global top streak if it has expired, and a player's global best if not known or expired. Caller
+	 * holds the lock, which is released while loading.
+	 */
+	void load_global(uint64_t user_id, std::unique_lock<std::mutex> &lock);
+public:
+	streak_index();
+
+	/* Returns a player's best streak on a guild, and the top streak of the guild */
+	struct streak_t get(uint64_t user_id, uint64_t guild_id);
+	/* Returns a player's best global streak, and the top global streak */
+	struct streak_t get(uint64_t user_id);
+
+	/* Record a new best streak on a guild, or globally */
+	void set(uint64_t user_id, uint64_t guild_id, uint32_t streak);
+	void set(uint64_t user_id, uint32_t streak);
+};
@@ -0,0 +1,200 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <unistd.h>
+#include <fmt/format.h>
+#include <sporks/database.h>
+#include <sporks/stringops.h>
+#include "teams.h"
+#include "trivia.h"
+#include "time.h"
+
+team_directory::team_directory() : loaded(false), last_joined(0)
+{
+}
+
+bool team_directory::ready()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return loaded;
+}
+
+void team_directory::reload()
+{
+	std::unordered_map<uint64_t, std::string> new_members;
+	std::unordered_map<std::string, uint64_t> new_scores;
+	uint64_t new_last_joined = 0;
+	time_t started = time(NULL);
+
+	db::resultset rs = db::query_ro("SELECT nick, team, joined FROM team_membership", {});
+	for (auto& r : rs) {
+		new_members[from_string<uint64_t>(r["nick"], std::dec)] = r["team"];
+		new_last_joined = std::max(new_last_joined, from_string<uint64_t>(r["joined"], std::dec));
+	}
+	rs = db::query_ro("SELECT name, score FROM teams", {});
+	for (auto& r : rs) {
+		new_scores[lowercase(r["name"])] = from_string<uint64_t>(r["score"], std::dec);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& s : new_scores) {
+		/* Points added here may not have been written yet, so never go backwards */
+		auto current = scores.find(s.first);
+		if (current != scores.end()) {
+			s.second = std::max(s.second, current->second);
+		}
+	}
+	members.swap(new_members);
+	scores.swap(new_scores);
+	/* Changes made while the queries ran, or not yet on the replica, are missing from what was read */
+	while (!changes.empty() && changes.front().when < started - TEAM_CHANGE_KEEP_SECS) {
+		changes.pop_front();
+	}
+	for (auto& c : changes) {
+		apply(c);
+	}
+	last_joined = std::max(last_joined, new_last_joined);
+	loaded = true;
+}
+
+void team_directory::refresh()
+{
+	std::string in;
+	db::paramlist teams;
+	uint64_t since;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto& t : touched) {
+			in += (in.empty() ? "'?'" : ",'?'");
+			teams.push_back(t);
+		}
+		touched.clear();
+		since = last_joined;
+	}
+
+	/* joined is now() as a number, so rows with the same second as the last one are read again */
+	db::resultset joins = db::query("SELECT nick, team, joined FROM team_membership WHERE joined >= ?", {since});
+	db::resultset points = in.empty() ? db::resultset() : db::query("SELECT name, score FROM teams WHERE name IN (" + in + ")", teams);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto& r : joins) {
+		members[from_string<uint64_t>(r["nick"], std::dec)] = r["team"];
+		last_joined = std::max(last_joined, from_string<uint64_t>(r["joined"], std::dec));
+	}
+	for (auto& r : points) {
+		/* Points added here may not have been written yet, so never go backwards */
+		uint64_t& score = scores[lowercase(r["name"])];
+		score = std::max(score, from_string<uint64_t>(r["score"], std::dec));
+	}
+}
+
+std::string team_directory::get_team(uint64_t user_id)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto m = members.find(user_id);
+	return m != members.end() ? m->second : "";
+}
+
+uint64_t team_directory::get_points(const std::string &team)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto s = scores.find(lowercase(team));
+	if (s == scores.end()) {
+		return 0;
+	}
+	touched.insert(s->first);
+	return s->second;
+}
+
+bool team_directory::exists(const std::string &team)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return scores.find(lowercase(team)) != scores.end();
+}
+
+void team_directory::apply(const change_t &c)
+{
+	if (c.user_id == 0) {
+		scores.emplace(lowercase(c.team), 0);
+	} else if (c.team.empty()) {
+		members.erase(c.user_id);
+	} else {
+		members[c.user_id] = c.team;
+	}
+}
+
+void team_directory::created(const std::string &team)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	changes.push_back({time(NULL), 0, team});
+	apply(changes.back());
+}
+
+void team_directory::joined(uint64_t user_id, const std::string &team)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	/* join_team() leaves an existing membership alone */
+	if (members.find(user_id) == members.end()) {
+		changes.push_back({time(NULL), user_id, team});
+		apply(changes.back());
+	}
+}
+
+void team_directory::left(uint64_t user_id)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	changes.push_back({time(NULL), user_id, ""});
+	apply(changes.back());
+}
+
+void team_directory::add_points(const std::string &team, int points)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto s = scores.find(lowercase(team));
+	if (s != scores.end()) {
+		s->second += points;
+	}
+}
+
+void TriviaModule::WatchTeams()
+{
+	time_t next_reload = 0;
+	while (!terminating) {
+		try {
+			/* A full reload picks up players leaving teams on the website, and other changes refresh() can't see */
+			if (time(NULL) >= next_reload) {
+				double start = time_f();
+				teams->reload();
+				next_reload = time(NULL) + TEAM_RELOAD_SECS;
+				bot->core->log(dpp::ll_debug, fmt::format("Reloaded team directory in {:.3f} seconds", time_f() - start));
+			} else {
+				teams->refresh();
+			}
+		}
+		catch (std::exception &e) {
+			bot->core->log(dpp::ll_error, fmt::format("Exception in WatchTeams: {}", e.what()));
+		}
+		for (int i = 0; i < TEAM_REFRESH_SECS && !terminating; ++i) {
+			sleep(1);
+		}
+	}
+}
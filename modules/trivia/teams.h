@@ -0,0 +1,82 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <ctime>
+#include <cstdint>
+
+/* Team membership of every player and the score of every team, so that answers can be credited to a team
+ * without reading the database. The directory is loaded by reload(), kept up to date by the bot's own team
+ * commands and score updates, and refresh() picks up changes made elsewhere in between.
+ * Team names compare without case, as they do in the database, so scores are keyed by the lowercased name.
+ */
+class team_directory
+{
+	/* A change made by the bot, kept for a while so that a reload() reading older data doesn't undo it */
+	struct change_t {
+		time_t when;
+		/* Zero for a newly created team */
+		uint64_t user_id;
+		/* Empty when the player left their team */
+		std::string team;
+	};
+
+	std::mutex mutex;
+	bool loaded;
+	std::unordered_map<uint64_t, std::string> members;
+	std::unordered_map<std::string, uint64_t> scores;
+	/* Teams whose scores have been asked for since the last refresh() */
+	std::unordered_set<std::string> touched;
+	/* Highest team_membership.joined seen */
+	uint64_t last_joined;
+	std::deque<change_t> changes;
+
+	void apply(const change_t &c);
+public:
+	team_directory();
+
+	/* False until the first reload() completes, callers should read the database until then */
+	bool ready();
+
+	/* Load everything from team_membership and teams */
+	void reload();
+
+	/* Read memberships added since the last load, and the scores of teams in use */
+	void refresh();
+
+	/* Returns a player's team, or an empty string */
+	std::string get_team(uint64_t user_id);
+	uint64_t get_points(const std::string &team);
+	bool exists(const std::string &team);
+
+	/* Called once changes by the bot have been committed to the database */
+	void created(const std::string &team);
+	void joined(uint64_t user_id, const std::string &team);
+	void left(uint64_t user_id);
+	void add_points(const std::string &team, int points);
+};
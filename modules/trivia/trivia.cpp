@@ -43,7 +43,7 @@
 
 using json = nlohmann::json;
 
-TriviaModule::TriviaModule(Bot* instigator, ModuleLoader* ml) : Module(instigator, ml), terminating(false), booted(false)
+TriviaModule::TriviaModule(Bot* instigator, ModuleLoader* ml) : Module(instigator, ml), terminating(false), settings_preload_thread(nullptr), resume_thread(nullptr), stop_poll(0), booted(false)
 {
 	/* TODO: Move to something better like mt-rand */
 	srand(time(NULL) * time(NULL));
@@ -66,10 +66,54 @@ TriviaModule::TriviaModule(Bot* instigator, ModuleLoader* ml) : Module(instigato
 	}
 	set_io_context(Bot::GetConfig("apikey"), bot, this);
 
+	/* Local record of game states for resuming, sent to the database by checkpoint_thread */
+	checkpoints = new game_checkpoints(fmt::format("checkpoint-{}.dat", bot->GetClusterID()));
+
+	/* Day, week and month scores per guild, filled on demand */
+	leaderboard = new leaderboards();
+
+	/* Global ranks of every player, loaded from the database by rank_thread */
+	ranks = new global_ranks();
+
+	/* Names, badges and achievements of users for embeds */
+	cards = new user_cards();
+
+	/* Best streaks per guild and globally, filled on demand */
+	streaks = new streak_index();
+
+	/* Team memberships and scores, loaded by team_thread */
+	teams = new team_directory();
+
+	/* Players banned from playing, refreshed by ban_watch_thread */
+	bans = new ban_list();
+	bans->reload();
+
+	/* Coin balances, with changes logged locally until coin_thread writes them to the database */
+	coins = new coin_ledger(fmt::format("coins-{}.log", bot->GetClusterID()), bot->GetClusterID());
+
+	/* Channel whitelists, shitlist and quickfire cooldowns checked by /start, refreshed by gate_thread */
+	gate = new start_gate();
+	gate->reload_config("../config.json");
+	gate->reload_whitelists();
+	gate->load_cooldowns(INSANE_COOLDOWN);
+
+	/* Webhooks of channels games are played in, filled on demand */
+	webhooks = new webhook_registry();
+
 	/* Create threads */
 	presence_update = new std::thread(&TriviaModule::UpdatePresenceLine, this);
 	game_tick_thread = new std::thread(&TriviaModule::Tick, this);
 	guild_queue_thread = new std::thread(&TriviaModule::ProcessGuildQueue, this);
+	settings_watch_thread = new std::thread(&TriviaModule::WatchGuildSettings, this);
+	help_watch_thread = new std::thread(&TriviaModule::WatchHelp, this);
+	checkpoint_thread = new std::thread(&TriviaModule::WatchCheckpoints, this);
+	stop_watch_thread = new std::thread(&TriviaModule::WatchStopRequests, this);
+	start_queue_thread = new std::thread(&TriviaModule::WatchStartQueue, this);
+	rank_thread = new std::thread(&TriviaModule::WatchRanks, this);
+	team_thread = new std::thread(&TriviaModule::WatchTeams, this);
+	ban_watch_thread = new std::thread(&TriviaModule::WatchBans, this);
+	coin_thread = new std::thread(&TriviaModule::WatchCoins, this);
+	gate_thread = new std::thread(&TriviaModule::WatchStartGate, this);
 
 	/* Get command list from API */
 	{
@@ -79,13 +123,16 @@ TriviaModule::TriviaModule(Bot* instigator, ModuleLoader* ml) : Module(instigato
 	}
 	{
 		std::unique_lock lang_lock(lang_mutex);
-		/* Read language strings */
-		std::ifstream langfile("../lang.json");
-		lang = new json();
-		langfile >> *lang;
-		bot->core->log(dpp::ll_info, fmt::format("Language strings count: {}", lang->size()));
+		/* Map language strings, compiled from lang.json at build time */
+		lang = new lang_table("lang.bin");
+		bot->core->log(dpp::ll_info, fmt::format("Language strings count: {}", lang.load()->size()));
 	}
 
+	LoadHelp();
+
+	/* If this is a reload, carry on the games from the previous instance */
+	AdoptGames();
+
 	achievements = new json();
 	std::ifstream achievements_json("../achievements.json");
 	achievements_json >> *achievements;
@@ -115,10 +162,33 @@ Bot* TriviaModule::GetBot()
 
 TriviaModule::~TriviaModule()
 {
-	/* We don't just delete threads, they must go through Bot::DisposeThread which joins them first */
+	/* Signal our threads to exit. We don't just delete threads, they must go through Bot::DisposeThread which joins them first */
+	terminating = true;
+	DisposeThread(resume_thread);
 	DisposeThread(game_tick_thread);
+
+	/* Now that games have stopped ticking, hand them to the next instance of the module */
+	HandOffGames();
+
 	DisposeThread(presence_update);
 	DisposeThread(guild_queue_thread);
+	DisposeThread(settings_watch_thread);
+	DisposeThread(settings_preload_thread);
+	DisposeThread(help_watch_thread);
+	DisposeThread(checkpoint_thread);
+	DisposeThread(stop_watch_thread);
+	DisposeThread(start_queue_thread);
+	DisposeThread(rank_thread);
+	DisposeThread(team_thread);
+	DisposeThread(ban_watch_thread);
+	DisposeThread(coin_thread);
+	DisposeThread(gate_thread);
+
+	/* Async query callbacks run on the bot's pool threads but their code is in this module,
+	 * so none may be left queued or running once it is unloaded.
+	 */
+	db::cancel_async(this);
+	db::cancel_async(leaderboard);
 
 	/* This explicitly calls the destructor on all states */
 	std::lock_guard<std::mutex> state_lock(states_mutex);
@@ -130,9 +200,22 @@ TriviaModule::~TriviaModule()
 	delete number_tidy_positive;
 	delete number_tidy_negative;
 	delete prefix_match;
-	delete lang;
+	delete lang.load();
+	for (auto& oldlang : retired_lang) {
+		delete oldlang.second;
+	}
 	delete achievements;
 	delete censor;
+	delete checkpoints;
+	delete leaderboard;
+	delete ranks;
+	delete cards;
+	delete streaks;
+	delete teams;
+	delete bans;
+	delete coins;
+	delete gate;
+	delete webhooks;
 }
 
 
@@ -170,18 +253,20 @@ bool TriviaModule::OnPresenceUpdate()
 	return true;
 }
 
-std::string TriviaModule::_(const std::string &k, const guild_settings_t& settings)
+std::string TriviaModule::_(lang_key k, const guild_settings_t& settings)
 {
-	/* Find language string 'k' in lang.json for the language specified in 'settings' */
-	std::shared_lock lang_lock(lang_mutex);
-	auto o = lang->find(k);
-	if (o != lang->end()) {
-		auto v = o->find(settings.language);
-		if (v != o->end()) {
-			return v->get<std::string>();
-		}
-	}
-	return k;
+	std::string_view v = langview(k, settings);
+	/* A missing string shows its key name, so it can be spotted and added */
+	return std::string(v.data() ? v : k.name);
+}
+
+std::string_view TriviaModule::langview(lang_key k, const guild_settings_t& settings)
+{
+	/* Find language string 'k' in lang.json for the language specified in 'settings'.
+	 * The view stays valid for LANG_RETIRE_SECS after lang.bin is next reloaded. If the
+	 * string is missing the view is empty.
+	 */
+	return lang.load(std::memory_order_acquire)->get(k, settings.language);
 }
 
 bool TriviaModule::OnGuildCreate(const dpp::guild_create_t &guild)
@@ -195,82 +280,152 @@ bool TriviaModule::OnGuildCreate(const dpp::guild_create_t &guild)
 bool TriviaModule::OnAllShardsReady()
 {
 	/* Called when the framework indicates all shards are connected */
-	char hostname[1024];
-	hostname[1023] = '\0';
-	gethostname(hostname, 1023);
-	db::resultset active = db::query("SELECT * FROM active_games WHERE hostname = '?' AND cluster_id = '?'", {hostname, bot->GetClusterID()});
-
 	this->booted = true;
 
+	/* Warm the settings cache for every guild on this cluster in the background,
+	 * so the first message from each guild doesn't have to query for its settings.
+	 */
+	DisposeThread(settings_preload_thread);
+	settings_preload_thread = new std::thread(&TriviaModule::PreloadGuildSettings, this);
+
 	if (bot->IsTestMode()) {
 		/* Don't resume games in test mode */
 		bot->core->log(dpp::ll_debug, fmt::format("Not resuming games in test mode"));
 		return true;
-	} else {
-		bot->core->log(dpp::ll_debug, fmt::format("Resuming {} games...", active.size()));
 	}
 
-	/* Iterate all active games for this cluster id */
-	for (auto game = active.begin(); game != active.end(); ++game) {
-
-		uint64_t guild_id = from_string<uint64_t>((*game)["guild_id"], std::dec);
-		bool quickfire = (*game)["quickfire"] == "1";
-		uint64_t channel_id = from_string<uint64_t>((*game)["channel_id"], std::dec);
-
-		bot->core->log(dpp::ll_info, fmt::format("Resuming id {}", channel_id));
-
-		/* XXX: Note: The mutex here is VITAL to thread safety of the state list! DO NOT move it! */
-		{
-			std::lock_guard<std::mutex> states_lock(states_mutex);
+	/* After a crash there may be hundreds of games to resume, so this is done in the background */
+	DisposeThread(resume_thread);
+	resume_thread = new std::thread(&TriviaModule::ResumeGames, this);
+	return true;
+}
 
-			/* Check that impatient user didn't (re)start the round while bot was synching guilds! */
-			if (states.find(channel_id) == states.end()) {
+/* Resume all active games for this cluster id, in parallel batches paced by the resumebatch and resumepace settings */
+void TriviaModule::ResumeGames()
+{
+	double start = dpp::utility::time_f();
+	char hostname[1024];
+	hostname[1023] = '\0';
+	gethostname(hostname, 1023);
+	db::resultset active = db::query("SELECT * FROM active_games WHERE hostname = '?' AND cluster_id = '?'", {hostname, bot->GetClusterID()});
 
-				std::vector<std::string> shuffle_list;
-				guild_settings_t s = GetGuildSettings(guild_id);
+	size_t batch_size = std::max(1u, from_string<uint32_t>(Bot::GetConfig("resumebatch", std::to_string(RESUME_BATCH)), std::dec));
+	uint32_t pace = from_string<uint32_t>(Bot::GetConfig("resumepace", std::to_string(RESUME_PACE)), std::dec);
+	bot->core->log(dpp::ll_debug, fmt::format("Resuming {} games, {} at a time...", active.size(), batch_size));
 
-				/* Get shuffle list from state in db */
-				if (!(*game)["qlist"].empty()) {
-					json shuffle = json::parse((*game)["qlist"]);
-					for (auto s = shuffle.begin(); s != shuffle.end(); ++s) {
-						shuffle_list.push_back(s->get<std::string>());
-					}
-				} else {
-					/* No shuffle list to resume from, create a new one */
-					try {
-						shuffle_list = fetch_shuffle_list(from_string<uint64_t>((*game)["guild_id"], std::dec), "");
-					}
-					catch (const std::exception&) {
-						shuffle_list = {};
+	/* Forget checkpoints of games which ended, or were stopped from the dashboard, while we were down */
+	std::unordered_set<uint64_t> channels;
+	for (auto& game : active) {
+		channels.insert(from_string<uint64_t>(game["channel_id"], std::dec));
+	}
+	checkpoints->retain(channels);
+
+	std::atomic<uint32_t> resumed = 0;
+	for (size_t batch = 0; batch < active.size() && !terminating; batch += batch_size) {
+		double batch_start = dpp::utility::time_f();
+		std::vector<std::thread> workers;
+		for (size_t i = batch; i < active.size() && i < batch + batch_size; ++i) {
+			workers.emplace_back([this, &active, &resumed, i]() {
+				try {
+					if (ResumeGame(active[i])) {
+						resumed++;
 					}
 				}
-				int32_t round = from_string<uint32_t>((*game)["question_index"], std::dec);
-
-				states[channel_id] = state_t(
-					this,
-					from_string<uint32_t>((*game)["questions"], std::dec) + 1,
-					from_string<uint32_t>((*game)["streak"], std::dec),
-					from_string<uint64_t>((*game)["lastanswered"], std::dec),
-					round,
-					(quickfire ? (TRIV_INTERVAL / 4) : TRIV_INTERVAL),
-					channel_id,
-					((*game)["hintless"]) == "1",
-					shuffle_list,
-					(trivia_state_t)from_string<uint32_t>((*game)["state"], std::dec),
-					guild_id
-				);
-				/* Force fetching of question */
-				states[channel_id].build_question_cache(s);
-				if (states[channel_id].is_insane_round(s)) {
-					states[channel_id].do_insane_round(true, s);
-				} else {
-					states[channel_id].do_normal_round(true, s);
+				catch (const std::exception &e) {
+					bot->core->log(dpp::ll_error, fmt::format("Can't resume game on channel {}: {}", active[i]["channel_id"], e.what()));
 				}
+			});
+		}
+		for (auto & w : workers) {
+			w.join();
+		}
+		/* Pace the batches, so that resuming doesn't flood discord or the database */
+		int32_t wait = pace - (int32_t)((dpp::utility::time_f() - batch_start) * 1000);
+		if (wait > 0 && batch + batch_size < active.size()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+		}
+	}
+	bot->core->log(dpp::ll_info, fmt::format("Resumed {} of {} games in {:.03f} seconds", resumed.load(), active.size(), dpp::utility::time_f() - start));
+}
 
-				bot->core->log(dpp::ll_info, fmt::format("Resumed game on guild {}, channel {}, {} questions [{}]", guild_id, channel_id, states[channel_id].numquestions, quickfire ? "quickfire" : "normal"));
-			}
+/* Resume one game from its active_games row. The game is loaded without holding states_mutex,
+ * which is only taken to add the finished state. Returns false if the channel already has a game.
+ */
+bool TriviaModule::ResumeGame(db::row &game)
+{
+	uint64_t guild_id = from_string<uint64_t>(game["guild_id"], std::dec);
+	bool quickfire = game["quickfire"] == "1";
+	uint64_t channel_id = from_string<uint64_t>(game["channel_id"], std::dec);
+
+	bot->core->log(dpp::ll_info, fmt::format("Resuming id {}", channel_id));
+
+	{
+		std::lock_guard<std::mutex> states_lock(states_mutex);
+		if (states.find(channel_id) != states.end()) {
+			return false;
+		}
+	}
+
+	std::vector<std::string> shuffle_list;
+	guild_settings_ptr s = GetGuildSettings(guild_id);
+
+	/* Get shuffle list from state in db */
+	if (!game["qlist"].empty()) {
+		json shuffle = json::parse(game["qlist"]);
+		for (auto s = shuffle.begin(); s != shuffle.end(); ++s) {
+			shuffle_list.push_back(s->get<std::string>());
+		}
+	} else {
+		/* No shuffle list to resume from, create a new one */
+		try {
+			shuffle_list = fetch_shuffle_list(guild_id, "");
+		}
+		catch (const std::exception&) {
+			shuffle_list = {};
+		}
+	}
+	/* The local checkpoint is more recent than the database, which is only updated every CHECKPOINT_FLUSH_SECS */
+	game_checkpoint_t checkpoint;
+	if (!checkpoints->find(channel_id, checkpoint)) {
+		checkpoint.question_index = from_string<uint32_t>(game["question_index"], std::dec);
+		checkpoint.streak = from_string<uint32_t>(game["streak"], std::dec);
+		checkpoint.lastanswered = from_string<uint64_t>(game["lastanswered"], std::dec);
+		checkpoint.state = from_string<uint32_t>(game["state"], std::dec);
+	}
+
+	state_t state(
+		this,
+		from_string<uint32_t>(game["questions"], std::dec) + 1,
+		checkpoint.streak,
+		checkpoint.lastanswered,
+		checkpoint.question_index,
+		(quickfire ? (TRIV_INTERVAL / 4) : TRIV_INTERVAL),
+		channel_id,
+		game["hintless"] == "1",
+		shuffle_list,
+		(trivia_state_t)checkpoint.state,
+		guild_id
+	);
+	/* Force fetching of question */
+	state.build_question_cache(*s);
+	if (state.is_insane_round(*s)) {
+		state.do_insane_round(true, *s);
+	} else {
+		state.do_normal_round(true, *s);
+	}
+
+	/* XXX: Note: The mutex here is VITAL to thread safety of the state list! DO NOT move it! */
+	{
+		std::lock_guard<std::mutex> states_lock(states_mutex);
+
+		/* Check that impatient user didn't (re)start the round while we were loading it! */
+		if (states.find(channel_id) != states.end()) {
+			return false;
 		}
+		states[channel_id] = state;
 	}
+
+	bot->core->log(dpp::ll_info, fmt::format("Resumed game on guild {}, channel {}, {} questions [{}]", guild_id, channel_id, state.numquestions, quickfire ? "quickfire" : "normal"));
 	return true;
 }
 
@@ -289,6 +444,7 @@ bool TriviaModule::OnGuildDelete(const dpp::guild_delete_t &gd)
 			settings_cache.erase(gd.deleted->id);
 		}
 		db::backgroundquery("UPDATE trivia_guild_cache SET kicked = 1 WHERE snowflake_id = ?", {gd.deleted->id});
+		forget_cached_guild(gd.deleted->id);
 		bot->core->log(dpp::ll_info, fmt::format("Kicked from guild id {}", gd.deleted->id));
 	} else {
 		bot->core->log(dpp::ll_info, fmt::format("Outage on guild id {}", gd.deleted->id));
@@ -312,7 +468,7 @@ uint64_t TriviaModule::GetActiveLocalGames()
 uint64_t TriviaModule::GetActiveGames()
 {
 	/* Counts all games across all clusters */
-	auto rs = db::query("SELECT SUM(games) AS games FROM infobot_discord_counts WHERE dev = ?", {bot->IsDevMode() ? 1 : 0});
+	auto rs = db::query_ro("SELECT SUM(games) AS games FROM infobot_discord_counts WHERE dev = ?", {bot->IsDevMode() ? 1 : 0});
 	if (rs.size()) {
 		return from_string<uint64_t>(rs[0]["games"], std::dec);
 	} else {
@@ -323,7 +479,7 @@ uint64_t TriviaModule::GetActiveGames()
 uint64_t TriviaModule::GetGuildTotal()
 {
 	/* Counts all games across all clusters */
-	auto rs = db::query("SELECT SUM(server_count) AS server_count FROM infobot_discord_counts WHERE dev = ?", {bot->IsDevMode() ? 1 : 0});
+	auto rs = db::query_ro("SELECT SUM(server_count) AS server_count FROM infobot_discord_counts WHERE dev = ?", {bot->IsDevMode() ? 1 : 0});
 	if (rs.size()) {
 		return from_string<uint64_t>(rs[0]["server_count"], std::dec);
 	} else {
@@ -334,7 +490,7 @@ uint64_t TriviaModule::GetGuildTotal()
 uint64_t TriviaModule::GetMemberTotal()
 {
 	/* Counts all games across all clusters */
-	auto rs = db::query("SELECT SUM(user_count) AS user_count FROM infobot_discord_counts WHERE dev = ?", {bot->IsDevMode() ? 1 : 0});
+	auto rs = db::query_ro("SELECT SUM(user_count) AS user_count FROM infobot_discord_counts WHERE dev = ?", {bot->IsDevMode() ? 1 : 0});
 	if (rs.size()) {
 		return from_string<uint64_t>(rs[0]["user_count"], std::dec);
 	} else {
@@ -345,7 +501,7 @@ uint64_t TriviaModule::GetMemberTotal()
 uint64_t TriviaModule::GetChannelTotal()
 {
 	/* Counts all games across all clusters */
-	auto rs = db::query("SELECT SUM(channel_count) AS channel_count FROM infobot_discord_counts WHERE dev = ?", {bot->IsDevMode() ? 1 : 0});
+	auto rs = db::query_ro("SELECT SUM(channel_count) AS channel_count FROM infobot_discord_counts WHERE dev = ?", {bot->IsDevMode() ? 1 : 0});
 	if (rs.size()) {
 		return from_string<uint64_t>(rs[0]["channel_count"], std::dec);
 	} else {
@@ -362,51 +518,232 @@ void TriviaModule::eraseCache(dpp::snowflake guild_id)
 	}
 }
 
-const guild_settings_t TriviaModule::GetGuildSettings(dpp::snowflake guild_id)
+/* Build a settings snapshot from a bot_guild_settings row */
+guild_settings_ptr TriviaModule::ParseGuildSettings(db::row &r)
+{
+	std::stringstream s(r["moderator_roles"]);
+	uint64_t role_id;
+	std::vector<uint64_t> role_list;
+	while ((s >> role_id)) {
+		role_list.push_back(role_id);
+	}
+	std::string max_n = r["max_normal_round"], max_q = r["max_quickfire_round"], max_h = r["max_hardcore_round"];
+	return std::make_shared<const guild_settings_t>(time(NULL), from_string<uint64_t>(r["snowflake_id"], std::dec), r["prefix"], role_list, from_string<uint32_t>(r["embedcolour"], std::dec), (r["premium"] == "1"), (r["only_mods_stop"] == "1"), (r["only_mods_start"] == "1"), (r["role_reward_enabled"] == "1"), from_string<uint64_t>(r["role_reward_id"], std::dec), r["custom_url"], r["language"], from_string<uint32_t>(r["question_interval"], std::dec), max_n.empty() ? 200 : from_string<uint32_t>(max_n, std::dec), max_q.empty() ? (r["premium"] == "1" ? 200 : 15) : from_string<uint32_t>(max_q, std::dec), max_h.empty() ? 200 : from_string<uint32_t>(max_h, std::dec), r["disable_insane_rounds"] == "1");
+}
+
+/* Returns the settings snapshot for a guild. Snapshots stay cached until the settings change
+ * (see CheckSettingsChanges) or the bot leaves the guild. If several threads miss the cache for
+ * the same guild at once, only the first queries the database and the rest wait for its result.
+ */
+guild_settings_ptr TriviaModule::GetGuildSettings(dpp::snowflake guild_id)
 {
-	bool expired = false;
-	auto i = settings_cache.end();
 	{
 		std::shared_lock locker(settingcache_mutex);
-		i = settings_cache.find(guild_id);
+		auto i = settings_cache.find(guild_id);
 		if (i != settings_cache.end()) {
-			if (time(NULL) > i->second.time + 60) {
-				expired = true;
-			} else {
-				return i->second;
-			}
+			return i->second;
 		}
 	}
-	if (expired) {
-		this->eraseCache(guild_id);
+
+	std::promise<guild_settings_ptr> fetch;
+	std::shared_future<guild_settings_ptr> pending;
+	{
+		std::unique_lock locker(settingcache_mutex);
+		auto i = settings_cache.find(guild_id);
+		if (i != settings_cache.end()) {
+			return i->second;
+		}
+		auto f = settings_fetching.find(guild_id);
+		if (f != settings_fetching.end()) {
+			pending = f->second;
+		} else {
+			settings_fetching.emplace(guild_id, fetch.get_future().share());
+		}
 	}
-	
-	db::resultset r = db::query("SELECT * FROM bot_guild_settings WHERE snowflake_id = ?", {guild_id});
-	if (!r.empty()) {
-		std::stringstream s(r[0]["moderator_roles"]);
-		uint64_t role_id;
-		std::vector<uint64_t> role_list;
-		while ((s >> role_id)) {
-			role_list.push_back(role_id);
-		}
-		std::string max_n = r[0]["max_normal_round"], max_q = r[0]["max_quickfire_round"], max_h = r[0]["max_hardcore_round"];
-		guild_settings_t gs(time(NULL), from_string<uint64_t>(r[0]["snowflake_id"], std::dec), r[0]["prefix"], role_list, from_string<uint32_t>(r[0]["embedcolour"], std::dec), (r[0]["premium"] == "1"), (r[0]["only_mods_stop"] == "1"), (r[0]["only_mods_start"] == "1"), (r[0]["role_reward_enabled"] == "1"), from_string<uint64_t>(r[0]["role_reward_id"], std::dec), r[0]["custom_url"], r[0]["language"], from_string<uint32_t>(r[0]["question_interval"], std::dec), max_n.empty() ? 200 : from_string<uint32_t>(max_n, std::dec), max_q.empty() ? (r[0]["premium"] == "1" ? 200 : 15) : from_string<uint32_t>(max_q, std::dec), max_h.empty() ? 200 : from_string<uint32_t>(max_h, std::dec), r[0]["disable_insane_rounds"] == "1");
+	if (pending.valid()) {
+		return pending.get();
+	}
+
+	guild_settings_ptr gs;
+	try {
+		db::resultset r = db::query("SELECT * FROM bot_guild_settings WHERE snowflake_id = ?", {guild_id});
+		if (!r.empty()) {
+			gs = ParseGuildSettings(r[0]);
+		} else {
+			db::backgroundquery("INSERT INTO bot_guild_settings (snowflake_id) VALUES('?')", {guild_id});
+			gs = std::make_shared<const guild_settings_t>(time(NULL), guild_id, "!", std::vector<uint64_t>(), 3238819, false, false, false, false, 0, "", "en", 20, 200, 15, 200, false);
+		}
+	}
+	catch (...) {
+		/* Let the callers waiting on this fetch see the error too, and let the next caller try again */
 		{
 			std::unique_lock locker(settingcache_mutex);
-			settings_cache.emplace(guild_id, gs);
+			settings_fetching.erase(guild_id);
 		}
-		return gs;
-	} else {
-		db::backgroundquery("INSERT INTO bot_guild_settings (snowflake_id) VALUES('?')", {guild_id});
-		guild_settings_t gs(time(NULL), guild_id, "!", {}, 3238819, false, false, false, false, 0, "", "en", 20, 200, 15, 200, false);
+		fetch.set_exception(std::current_exception());
+		throw;
+	}
+	{
+		std::unique_lock locker(settingcache_mutex);
+		settings_cache[guild_id] = gs;
+		settings_fetching.erase(guild_id);
+	}
+	fetch.set_value(gs);
+	return gs;
+}
+
+/* Apply a change made by the bot itself to the cached settings of a guild, so that it takes
+ * effect immediately instead of waiting for the database write to be noticed.
+ */
+void TriviaModule::UpdateGuildSettings(dpp::snowflake guild_id, std::function<void(guild_settings_t&)> change)
+{
+	std::unique_lock locker(settingcache_mutex);
+	auto i = settings_cache.find(guild_id);
+	if (i != settings_cache.end()) {
+		auto updated = std::make_shared<guild_settings_t>(*(i->second));
+		change(*updated);
+		i->second = updated;
+	}
+}
+
+/* Replace cached settings snapshots for any guild whose bot_guild_settings row changed since the last
+ * check, including changes made by the dashboard. The updated_at column is maintained by the database.
+ * Rows from the last couple of seconds are looked at again each time, so that a change committed late
+ * with an earlier timestamp isn't missed.
+ */
+void TriviaModule::CheckSettingsChanges()
+{
+	if (settings_watermark.empty()) {
+		db::resultset now = db::query("SELECT NOW(3) AS now", {});
+		if (now.size()) {
+			settings_watermark = now[0]["now"];
+		}
+		return;
+	}
+	db::resultset changed = db::query("SELECT * FROM bot_guild_settings WHERE updated_at >= '?' - INTERVAL 2 SECOND ORDER BY updated_at", {settings_watermark});
+	for (auto & r : changed) {
+		dpp::snowflake guild_id = from_string<uint64_t>(r["snowflake_id"], std::dec);
 		{
-			std::unique_lock locker(settingcache_mutex);
-			settings_cache.emplace(guild_id, gs);
+			std::shared_lock locker(settingcache_mutex);
+			if (settings_cache.find(guild_id) == settings_cache.end()) {
+				continue;
+			}
 		}
-		return gs;
+		guild_settings_ptr gs = ParseGuildSettings(r);
+		std::unique_lock locker(settingcache_mutex);
+		settings_cache[guild_id] = gs;
+	}
+	if (changed.size()) {
+		settings_watermark = std::max(settings_watermark, changed.rbegin()->at("updated_at"));
 	}
 }
 
+/* Fetch settings for all guilds on this cluster's shards in chunks of SETTINGS_PRELOAD_CHUNK */
+void TriviaModule::PreloadGuildSettings()
+{
+	double start = dpp::utility::time_f();
+	std::vector<dpp::snowflake> guild_ids;
+	{
+		dpp::cache<dpp::guild>* c = dpp::get_guild_cache();
+		std::shared_lock l(c->get_mutex());
+		for (auto & g : c->get_container()) {
+			guild_ids.push_back(g.first);
+		}
+	}
+	size_t rows = 0, queries = 0;
+	try {
+		for (size_t chunk = 0; chunk < guild_ids.size() && !terminating; chunk += SETTINGS_PRELOAD_CHUNK) {
+			db::paramlist ids;
+			std::string placeholders;
+			for (size_t i = chunk; i < guild_ids.size() && i < chunk + SETTINGS_PRELOAD_CHUNK; ++i) {
+				ids.push_back((uint64_t)guild_ids[i]);
+				placeholders += (placeholders.empty() ? "?" : ",?");
+			}
+			db::resultset r = db::query("SELECT * FROM bot_guild_settings WHERE snowflake_id IN (" + placeholders + ")", ids);
+			queries++;
+			rows += r.size();
+			for (auto & row : r) {
+				guild_settings_ptr gs = ParseGuildSettings(row);
+				std::unique_lock locker(settingcache_mutex);
+				/* Don't replace anything fetched since we started, it will be newer */
+				settings_cache.emplace(gs->guild_id, gs);
+			}
+		}
+	}
+	catch (std::exception &e) {
+		bot->core->log(dpp::ll_error, fmt::format("Exception in PreloadGuildSettings: {}", e.what()));
+	}
+	bot->core->log(dpp::ll_info, fmt::format("Preloaded settings for {} of {} guilds in {} queries, {:.03f} seconds", rows, guild_ids.size(), queries, dpp::utility::time_f() - start));
+}
+
+void TriviaModule::WatchGuildSettings()
+{
+	while (!terminating) {
+		try {
+			CheckSettingsChanges();
+		}
+		catch (std::exception &e) {
+			bot->core->log(dpp::ll_error, fmt::format("Exception in WatchGuildSettings: {}", e.what()));
+		}
+		for (int i = 0; i < 5 && !terminating; ++i) {
+			sleep(1);
+		}
+	}
+}
+
+/* Poll for games on this cluster that have been stopped from the dashboard, with one query a second
+ * for the whole cluster. Games check the result with StopRequested() as they change state.
+ */
+void TriviaModule::WatchStopRequests()
+{
+	char hostname[1024];
+	hostname[1023] = '\0';
+	gethostname(hostname, 1023);
+	while (!terminating) {
+		try {
+			uint64_t poll;
+			{
+				std::lock_guard<std::mutex> stop_lock(stop_mutex);
+				poll = ++stop_poll;
+			}
+			db::resultset r = db::query("SELECT channel_id FROM active_games WHERE hostname = '?' AND cluster_id = '?' AND stop = 1", {std::string(hostname), bot->GetClusterID()});
+			std::lock_guard<std::mutex> stop_lock(stop_mutex);
+			std::unordered_set<uint64_t> stopped;
+			for (auto & row : r) {
+				uint64_t channel_id = from_string<uint64_t>(row["channel_id"], std::dec);
+				/* A request cleared while this poll ran may have been read before its game's row was deleted */
+				auto c = stop_cleared.find(channel_id);
+				if (c == stop_cleared.end() || c->second < poll) {
+					stopped.insert(channel_id);
+				}
+			}
+			stop_requests.swap(stopped);
+			/* Requests cleared before this poll started were deleted from the database before it read them */
+			for (auto c = stop_cleared.begin(); c != stop_cleared.end();) {
+				c = (c->second < poll ? stop_cleared.erase(c) : std::next(c));
+			}
+		}
+		catch (std::exception &e) {
+			bot->core->log(dpp::ll_error, fmt::format("Exception in WatchStopRequests: {}", e.what()));
+		}
+		sleep(1);
+	}
+}
+
+bool TriviaModule::StopRequested(uint64_t channel_id)
+{
+	std::lock_guard<std::mutex> stop_lock(stop_mutex);
+	return stop_requests.find(channel_id) != stop_requests.end();
+}
+
+/* Called when a game ends, so that a stop request can't carry over to the next game on the channel */
+void TriviaModule::ClearStopRequest(uint64_t channel_id)
+{
+	std::lock_guard<std::mutex> stop_lock(stop_mutex);
+	stop_requests.erase(channel_id);
+	stop_cleared[channel_id] = stop_poll;
+}
+
 std::string TriviaModule::GetVersion()
 {
 	/* NOTE: This version string below is modified by a pre-commit hook on the git repository */
@@ -437,15 +774,16 @@ void TriviaModule::UpdatePresenceLine()
 			bot->core->set_presence(dpp::presence(dpp::ps_online, dpp::at_game, presence));
 	
 			if (!bot->IsTestMode()) {
-				/* Don't handle shard reconnects or queued starts in test mode */
-				CheckForQueuedStarts();
+				/* Don't handle shard reconnects in test mode. Queued starts are handled by WatchStartQueue() */
 				CheckReconnects();
 			}
 		}
 		catch (std::exception &e) {
 			bot->core->log(dpp::ll_error, fmt::format("Exception in UpdatePresenceLine: {}", e.what()));
 		}
-		sleep(120);
+		for (int i = 0; i < 120 && !terminating; ++i) {
+			sleep(1);
+		}
 	}
 	bot->core->log(dpp::ll_debug, fmt::format("Presence thread exited."));
 }
@@ -468,17 +806,19 @@ std::string TriviaModule::vowelcount(const std::string &text, const guild_settin
 
 void TriviaModule::show_stats(const std::string& interaction_token, dpp::snowflake command_id, dpp::snowflake guild_id, dpp::snowflake channel_id)
 {
-	db::resultset topten = db::query("SELECT dayscore, name, emojis, trivia_user_cache.* FROM scores LEFT JOIN trivia_user_cache ON snowflake_id = name LEFT JOIN vw_emojis ON name = user_id WHERE guild_id = ? and dayscore > 0 ORDER BY dayscore DESC limit 10", {guild_id});
+	std::vector<leaderboard_entry_t> topten = leaderboard->top(guild_id, LB_DAY);
 	size_t count = 1;
 	std::string msg;
 	for(auto& r : topten) {
-		if (!r["username"].empty()) {
-			msg.append(fmt::format("{0}. `{1}#{2:04d}` ({3}) {4}\n", count++, r["username"], from_string<uint32_t>(r["discriminator"], std::dec), r["dayscore"], r["emojis"]));
+		leaderboard_user_t u;
+		if (leaderboard->get_user(r.user_id, u)) {
+			msg.append(fmt::format("{0}. `{1}#{2:04d}` ({3}) {4}\n", count++, u.username, u.discriminator, r.score, u.emojis));
 		} else {
-			msg.append(fmt::format("{}. <@{}> ({})\n", count++, r["snowflake_id"], r["dayscore"]));
+			msg.append(fmt::format("{}. <@{}> ({})\n", count++, r.user_id, r.score));
 		}
 	}
-	guild_settings_t settings = GetGuildSettings(guild_id);
+	guild_settings_ptr settings_ptr = GetGuildSettings(guild_id);
+	const guild_settings_t& settings = *settings_ptr;
 	if (msg.empty()) {
 		msg = _("NOBODY_PLAYED_TODAY", settings);
 	}
@@ -537,29 +877,55 @@ void state_t::StopGame(const guild_settings_t &settings)
 
 dpp::user dummyuser;
 
+/* Claim and start games queued from the dashboard for guilds on this cluster. Rows are locked with
+ * SKIP LOCKED and deleted in the same transaction, so two clusters can never both claim the same start.
+ */
 void TriviaModule::CheckForQueuedStarts()
 {
-	db::resultset rs = db::query("SELECT * FROM start_queue ORDER BY queuetime", {});
-	for (auto r = rs.begin(); r != rs.end(); ++r) {
-		uint64_t guild_id = from_string<uint64_t>((*r)["guild_id"], std::dec);
-		/* Check that this guild is on this cluster, if so we can start this game */
-		dpp::guild* g = dpp::find_guild(guild_id);
-		if (g) {
-
-			uint64_t channel_id = from_string<uint64_t>((*r)["channel_id"], std::dec);
-			uint64_t user_id = from_string<uint64_t>((*r)["user_id"], std::dec);
-			uint32_t questions = from_string<uint32_t>((*r)["questions"], std::dec);
-			uint32_t quickfire = from_string<uint32_t>((*r)["quickfire"], std::dec);
-			uint32_t hintless = from_string<uint32_t>((*r)["hintless"], std::dec);
-			std::string category = (*r)["category"];
-
-			bot->core->log(dpp::ll_info, fmt::format("Remote start, guild_id={} channel_id={} user_id={} questions={} type={} category='{}'", guild_id, channel_id, user_id, questions, hintless ? "hardcore" : (quickfire ? "quickfire" : "normal"), category));
-
-			queue_command(fmt::format("{} {}{}", (hintless ? "hardcore" : (quickfire ? "quickfire" : "start")), questions, (category.empty() ? "" : (std::string(" ") + category))), user_id, channel_id, guild_id, false, "Dashboard", true, dpp::user(), dpp::guild_member());
+	std::vector<db::row> claimed;
+	{
+		db::transaction t;
+		db::resultset rs = t.query("SELECT * FROM start_queue WHERE ((guild_id >> 22) % ?) % ? = ? ORDER BY queuetime LIMIT ? FOR UPDATE SKIP LOCKED",
+			{bot->core->numshards, std::max(1u, bot->GetMaxClusters()), bot->GetClusterID(), START_QUEUE_CLAIM});
+		for (auto & r : rs) {
+			/* Check that this guild is on this cluster, if so we can start this game */
+			if (dpp::find_guild(from_string<uint64_t>(r["guild_id"], std::dec))) {
+				t.add("DELETE FROM start_queue WHERE guild_id = ? AND channel_id = ?", {r["guild_id"], r["channel_id"]});
+				claimed.push_back(r);
+			}
+		}
+		if (claimed.empty() || !t.commit()) {
+			return;
+		}
+	}
+	for (auto & r : claimed) {
+		uint64_t guild_id = from_string<uint64_t>(r["guild_id"], std::dec);
+		uint64_t channel_id = from_string<uint64_t>(r["channel_id"], std::dec);
+		uint64_t user_id = from_string<uint64_t>(r["user_id"], std::dec);
+		uint32_t questions = from_string<uint32_t>(r["questions"], std::dec);
+		uint32_t quickfire = from_string<uint32_t>(r["quickfire"], std::dec);
+		uint32_t hintless = from_string<uint32_t>(r["hintless"], std::dec);
+		std::string category = r["category"];
+
+		bot->core->log(dpp::ll_info, fmt::format("Remote start, guild_id={} channel_id={} user_id={} questions={} type={} category='{}'", guild_id, channel_id, user_id, questions, hintless ? "hardcore" : (quickfire ? "quickfire" : "normal"), category));
+
+		queue_command(fmt::format("{} {}{}", (hintless ? "hardcore" : (quickfire ? "quickfire" : "start")), questions, (category.empty() ? "" : (std::string(" ") + category))), user_id, channel_id, guild_id, false, "Dashboard", true, dpp::user(), dpp::guild_member());
+	}
+}
 
-			/* Delete just this entry as we've processed it */
-			db::query("DELETE FROM start_queue WHERE channel_id = ?", {channel_id});
+void TriviaModule::WatchStartQueue()
+{
+	while (!terminating) {
+		try {
+			/* Don't handle queued starts in test mode */
+			if (booted && !bot->IsTestMode()) {
+				CheckForQueuedStarts();
+			}
+		}
+		catch (std::exception &e) {
+			bot->core->log(dpp::ll_error, fmt::format("Exception in WatchStartQueue: {}", e.what()));
 		}
+		sleep(1);
 	}
 }
 
@@ -608,12 +974,14 @@ bool TriviaModule::RealOnMessage(const dpp::message_create_t &message, const std
 	} else {
 
 		if (mentioned && prefix_match->Match(clean_message)) {
-			guild_settings_t settings = GetGuildSettings(guild_id);
+			guild_settings_ptr settings_ptr = GetGuildSettings(guild_id);
+			const guild_settings_t& settings = *settings_ptr;
 			bot->core->message_create(dpp::message(channel_id, fmt::format(_("PREFIX", settings), settings.prefix, settings.prefix)));
 			bot->core->log(dpp::ll_debug, fmt::format("Respond to prefix request on channel C:{} A:{}", channel_id, author_id));
 		} else {
 
-			guild_settings_t settings = GetGuildSettings(guild_id);
+			guild_settings_ptr settings_ptr = GetGuildSettings(guild_id);
+			const guild_settings_t& settings = *settings_ptr;
 
 			// Commands
 			if (lowercase(clean_message.substr(0, settings.prefix.length())) == lowercase(settings.prefix)) {
@@ -33,7 +33,21 @@
 #include <mutex>
 #include <shared_mutex>
 #include <deque>
+#include <future>
+#include <functional>
 #include "settings.h"
+#include "lang.h"
+#include "help.h"
+#include "checkpoint.h"
+#include "leaderboard.h"
+#include "ranking.h"
+#include "usercard.h"
+#include "streaks.h"
+#include "teams.h"
+#include "bans.h"
+#include "coins.h"
+#include "startgate.h"
+#include "webhooks.h"
 #include "commands.h"
 #include "state.h"
 #include "neutrino_api.h"
@@ -48,6 +62,53 @@
 // Number of seconds between allowed API-bound calls, per channel
 #define PER_CHANNEL_RATE_LIMIT 4
 
+// Number of guilds whose settings are fetched per query by PreloadGuildSettings()
+#define SETTINGS_PRELOAD_CHUNK 1000
+
+// Number of questions fetched per query by question_t::fetch_many()
+#define QUESTION_FETCH_CHUNK 500
+
+// Default number of games resumed in parallel per batch at startup, and minimum milliseconds
+// between the start of each batch. Configurable as resumebatch and resumepace in config.json.
+#define RESUME_BATCH 10
+#define RESUME_PACE 1000
+
+// Maximum number of dashboard starts claimed from start_queue per second
+#define START_QUEUE_CLAIM 50
+
+// Default number of seconds between rebuilds of the global rank index from global_scores,
+// which picks up scores from other clusters. Configurable as rankrebuild in config.json.
+#define RANK_REBUILD_SECS 3600
+
+// Number of seconds between refreshes of the team directory, and between full reloads of it
+#define TEAM_REFRESH_SECS 10
+#define TEAM_RELOAD_SECS 600
+// Number of seconds the bot's own team changes are reapplied over a reload, to cover replica lag
+#define TEAM_CHANGE_KEEP_SECS 60
+
+// Number of seconds between checks for changed play bans
+#define BAN_REFRESH_SECS 5
+
+// Number of seconds between writes of coin drops and gives to the database
+#define COIN_FLUSH_SECS 2
+
+// Number of seconds between reloads of channel whitelists and the config.json shitlist
+#define START_GATE_REFRESH_SECS 30
+
+// Number of seconds a non-premium guild must wait between quickfire rounds
+#define INSANE_COOLDOWN 900
+
+// Number of seconds between sending game checkpoints to the database
+#define CHECKPOINT_FLUSH_SECS 10
+
+// Number of seconds a replaced language table is kept for threads still reading it
+#define LANG_RETIRE_SECS 300
+
+// Name, format version and maximum age in seconds of games handed off across a module reload
+#define HANDOFF_NAME "trivia_games"
+#define HANDOFF_VERSION 1
+#define HANDOFF_MAX_AGE 60
+
 typedef std::map<dpp::snowflake, dpp::snowflake> teamlist_t;
 
 struct field_t
@@ -96,37 +157,97 @@ class TriviaModule : public Module
 	std::thread* command_processor;
 	std::thread* game_tick_thread;
 	std::thread* guild_queue_thread;
-	std::shared_mutex lang_mutex;
+	/* Serialises reloads of lang.json; readers of lang take no lock */
+	std::mutex lang_mutex;
 	time_t lastlang;
+	/* Replaced language tables, and when they were replaced */
+	std::deque<std::pair<time_t, const lang_table*>> retired_lang;
 	command_list_t commands;
 	std::shared_mutex settingcache_mutex;
-	std::unordered_map<dpp::snowflake, guild_settings_t> settings_cache;
+	std::unordered_map<dpp::snowflake, guild_settings_ptr> settings_cache;
+	/* Guild settings currently being fetched, so concurrent cache misses share one query */
+	std::unordered_map<dpp::snowflake, std::shared_future<guild_settings_ptr>> settings_fetching;
+	/* Database time of the last bot_guild_settings change seen by CheckSettingsChanges() */
+	std::string settings_watermark;
+	std::thread* settings_watch_thread;
+	std::thread* settings_preload_thread;
+	std::shared_mutex help_mutex;
+	std::shared_ptr<const help_pages> help;
+	std::thread* help_watch_thread;
+	std::thread* resume_thread;
+	std::thread* checkpoint_thread;
+	std::thread* stop_watch_thread;
+	std::thread* start_queue_thread;
+	std::thread* rank_thread;
+	std::thread* team_thread;
+	std::thread* ban_watch_thread;
+	std::thread* coin_thread;
+	std::thread* gate_thread;
+	/* Channels whose games have been stopped from the dashboard, refreshed by WatchStopRequests() */
+	std::mutex stop_mutex;
+	std::unordered_set<uint64_t> stop_requests;
+	/* Number of polls started by WatchStopRequests(), and the poll running when each channel's request was cleared */
+	uint64_t stop_poll;
+	std::unordered_map<uint64_t, uint64_t> stop_cleared;
+	/* Questions asked since the last FlushCheckpoints(), by question id */
+	std::mutex asked_mutex;
+	std::map<uint64_t, uint32_t> asked_questions;
 
 	void CheckLangReload();
 	bool booted;
 	void thinking(bool ephemeral, const dpp::interaction_create_t& event);
 	void eraseCache(dpp::snowflake guild_id);
+	guild_settings_ptr ParseGuildSettings(db::row &r);
+	void CheckSettingsChanges();
+	void WatchGuildSettings();
+	void PreloadGuildSettings();
+	void LoadHelp();
+	void HandOffGames();
+	void ResumeGames();
+	bool ResumeGame(db::row &game);
+	void FlushCheckpoints();
+	void WatchCheckpoints();
+	void WatchStopRequests();
+	void WatchStartQueue();
+	void WatchRanks();
+	void WatchTeams();
+	void WatchBans();
+	void WatchCoins();
+	void WatchStartGate();
+	void AdoptGames();
+	void WatchHelp();
 	bool has_rl_warn(dpp::snowflake channel_id);
 	bool has_limit(dpp::snowflake channel_id);
 	bool set_rl_warn(dpp::snowflake channel_id);
 	bool set_limit(dpp::snowflake channel_id);
 public:
 	time_t startup;
-	json* lang;
+	std::atomic<const lang_table*> lang;
 	json* achievements;
+	game_checkpoints* checkpoints;
+	leaderboards* leaderboard;
+	global_ranks* ranks;
+	user_cards* cards;
+	streak_index* streaks;
+	team_directory* teams;
+	ban_list* bans;
+	coin_ledger* coins;
+	start_gate* gate;
+	webhook_registry* webhooks;
 	std::mutex states_mutex;
 	std::map<dpp::snowflake, state_t> states;
 
 	std::mutex cs_mutex;
-	std::shared_mutex wh_mutex;
 	std::shared_mutex numstrlock;
 	std::unordered_map<dpp::snowflake, last_streak_t> last_channel_streaks;
-	std::unordered_map<dpp::snowflake, std::string> webhooks;
 	std::multimap<uint64_t, db::row> numstrs;
 
 	neutrino* censor;
 	
 	void ReloadNumStrs();
+	void CountQuestionAsked(uint64_t question_id);
+	bool StopRequested(uint64_t channel_id);
+	void ClearStopRequest(uint64_t channel_id);
 
 	TriviaModule(Bot* instigator, ModuleLoader* ml);
 	Bot* GetBot();
@@ -141,7 +262,8 @@ public:
 	void ProcessCommands();
 	void ProcessGuildQueue();
 	virtual bool OnPresenceUpdate();
-	std::string _(const std::string &k, const guild_settings_t& settings);
+	std::string _(lang_key k, const guild_settings_t& settings);
+	std::string_view langview(lang_key k, const guild_settings_t& settings);
 	virtual bool OnAllShardsReady();
 	virtual bool OnChannelDelete(const dpp::channel_delete_t &cd);
 	virtual bool OnGuildDelete(const dpp::guild_delete_t &gd);
@@ -155,7 +277,8 @@ public:
 	uint64_t GetMemberTotal();
 	uint64_t GetChannelTotal();
 
-	const guild_settings_t GetGuildSettings(dpp::snowflake guild_id);
+	guild_settings_ptr GetGuildSettings(dpp::snowflake guild_id);
+	void UpdateGuildSettings(dpp::snowflake guild_id, std::function<void(guild_settings_t&)> change);
 	std::string escape_json(const std::string &s);
 
 	void ProcessEmbed(const class guild_settings_t& settings, const std::string &embed_json, dpp::snowflake channelID);
@@ -0,0 +1,85 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <sporks/database.h>
+#include <sporks/stringops.h>
+#include "usercard.h"
+
+user_card_t::user_card_t() : found(false), discriminator(0)
+{
+}
+
+std::unordered_map<uint64_t, user_card_t> user_cards::get(const std::vector<uint64_t> &user_ids)
+{
+	std::unordered_map<uint64_t, user_card_t> cards;
+	std::string in;
+	db::paramlist missing;
+	time_t now = time(nullptr);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (uint64_t id : user_ids) {
+			auto c = cache.find(id);
+			if (c != cache.end() && c->second.expires > now) {
+				cards[id] = c->second.card;
+			} else if (cards.emplace(id, user_card_t()).second) {
+				in += (in.empty() ? "?" : ",?");
+				missing.push_back(id);
+			}
+		}
+	}
+	if (missing.empty()) {
+		return cards;
+	}
+
+	db::resultset users = db::query_ro("SELECT snowflake_id, username, discriminator, get_emojis(snowflake_id) AS emojis FROM trivia_user_cache WHERE snowflake_id IN (" + in + ")", missing);
+	for (auto& r : users) {
+		user_card_t& card = cards[from_string<uint64_t>(r["snowflake_id"], std::dec)];
+		card.found = true;
+		card.username = r["username"];
+		card.discriminator = from_string<uint32_t>(r["discriminator"], std::dec);
+		card.emojis = r["emojis"];
+	}
+	db::resultset achievements = db::query_ro("SELECT user_id, achievement_id, date_format(unlocked, '%d-%b-%Y') AS unlocked_friendly FROM achievements WHERE user_id IN (" + in + ")", missing);
+	for (auto& r : achievements) {
+		cards[from_string<uint64_t>(r["user_id"], std::dec)].achievements[from_string<uint32_t>(r["achievement_id"], std::dec)] = r["unlocked_friendly"];
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (cache.size() + missing.size() > USER_CARD_CACHE_MAX) {
+		for (auto c = cache.begin(); c != cache.end();) {
+			c = (c->second.expires <= now ? cache.erase(c) : std::next(c));
+		}
+		if (cache.size() + missing.size() > USER_CARD_CACHE_MAX) {
+			cache.clear();
+		}
+	}
+	for (auto& id : missing) {
+		uint64_t user_id = std::get<uint64_t>(id);
+		cache[user_id] = { now + USER_CARD_TTL, cards[user_id] };
+	}
+	return cards;
+}
+
+user_card_t user_cards::get(uint64_t user_id)
+{
+	return get(std::vector<uint64_t>{ user_id })[user_id];
+}
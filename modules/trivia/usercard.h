@@ -0,0 +1,71 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <ctime>
+#include <cstdint>
+
+// Number of seconds a user card is cached for
+#define USER_CARD_TTL 60
+
+// Maximum number of cached user cards, expired cards are dropped when this is reached
+#define USER_CARD_CACHE_MAX 10000
+
+/* What embeds show of a player: their name and badges from trivia_user_cache, and their achievements */
+struct user_card_t
+{
+	/* False if the user is not in trivia_user_cache */
+	bool found;
+	std::string username;
+	uint32_t discriminator;
+	/* Badges, from get_emojis() */
+	std::string emojis;
+	/* Unlocked achievement ids, and the date each was unlocked as dd-Mon-YYYY */
+	std::map<uint32_t, std::string> achievements;
+
+	user_card_t();
+};
+
+/* Loads user cards for embeds, any number at a time with one query for the names and one for the
+ * achievements, and keeps them for USER_CARD_TTL seconds.
+ */
+class user_cards
+{
+	struct cached_card_t
+	{
+		time_t expires;
+		user_card_t card;
+	};
+	std::mutex mutex;
+	std::unordered_map<uint64_t, cached_card_t> cache;
+public:
+	/* Get the cards of several users, loading any which are not cached */
+	std::unordered_map<uint64_t, user_card_t> get(const std::vector<uint64_t> &user_ids);
+
+	user_card_t get(uint64_t user_id);
+};
@@ -0,0 +1,84 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#include <mutex>
+#include <sporks/database.h>
+#include <sporks/stringops.h>
+#include "webhooks.h"
+
+webhook_t::webhook_t() : id(0), loaded(0), validated(0)
+{
+}
+
+webhook_t webhook_registry::get(uint64_t channel_id)
+{
+	time_t now = time(NULL);
+	{
+		std::shared_lock lock(wh_mutex);
+		auto i = webhooks.find(channel_id);
+		if (i != webhooks.end() && (i->second.id || now - i->second.loaded < WEBHOOK_MISSING_TTL)) {
+			return i->second;
+		}
+	}
+	webhook_t wh;
+	db::resultset rs = db::query("SELECT webhook_id, webhook FROM channel_webhooks WHERE channel_id = ?", {channel_id});
+	if (rs.size()) {
+		wh.id = from_string<uint64_t>(rs[0]["webhook_id"], std::dec);
+		wh.url = rs[0]["webhook"];
+	}
+	wh.loaded = now;
+	std::unique_lock lock(wh_mutex);
+	/* Another thread may have validated a webhook while we were reading */
+	auto i = webhooks.find(channel_id);
+	if (i != webhooks.end() && i->second.validated) {
+		return i->second;
+	}
+	webhooks[channel_id] = wh;
+	return wh;
+}
+
+bool webhook_registry::valid(uint64_t channel_id)
+{
+	std::shared_lock lock(wh_mutex);
+	auto i = webhooks.find(channel_id);
+	return i != webhooks.end() && i->second.id && time(NULL) - i->second.validated < WEBHOOK_VALIDATE_TTL;
+}
+
+void webhook_registry::validated(uint64_t channel_id, uint64_t webhook_id, const std::string &url)
+{
+	std::unique_lock lock(wh_mutex);
+	webhook_t& wh = webhooks[channel_id];
+	wh.id = webhook_id;
+	wh.url = url;
+	wh.loaded = wh.validated = time(NULL);
+}
+
+void webhook_registry::invalidate(uint64_t channel_id, const std::string &url)
+{
+	std::unique_lock lock(wh_mutex);
+	auto i = webhooks.find(channel_id);
+	if (i != webhooks.end() && i->second.id && i->second.url != url) {
+		return;
+	}
+	webhooks[channel_id] = webhook_t();
+	webhooks[channel_id].loaded = time(NULL);
+}
@@ -0,0 +1,72 @@
+/************************************************************************************
+ *
+ * TriviaBot, The trivia bot for discord based on Fruitloopy Trivia for ChatSpike IRC
+ *
+ * Copyright 2004 Craig Edwards <support@brainbox.cc>
+ *
+ * Core based on Sporks, the Learning Discord Bot, Craig Edwards (c) 2019.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ************************************************************************************/
+
+#pragma once
+
+#include <string>
+#include <shared_mutex>
+#include <unordered_map>
+#include <ctime>
+#include <cstdint>
+
+// Number of seconds a webhook is trusted after Discord last confirmed it exists
+#define WEBHOOK_VALIDATE_TTL 3600
+
+// Number of seconds a channel is remembered as having no webhook before the database is asked again
+#define WEBHOOK_MISSING_TTL 300
+
+/* A channel's webhook. An id of 0 means the channel has none */
+struct webhook_t
+{
+	uint64_t id;
+	std::string url;
+	/* When the entry was read from channel_webhooks or last changed */
+	time_t loaded;
+	/* When Discord last confirmed the webhook exists, or 0 if it hasn't since it was loaded */
+	time_t validated;
+
+	webhook_t();
+};
+
+/* The webhooks of channels games are played in. A known webhook is used until posting to it fails with
+ * a 404, which invalidates it; a channel known to have none is only looked up again after
+ * WEBHOOK_MISSING_TTL seconds.
+ */
+class webhook_registry
+{
+	std::shared_mutex wh_mutex;
+	std::unordered_map<uint64_t, webhook_t> webhooks;
+public:
+	/* Returns the webhook for a channel, reading channel_webhooks if it isn't known */
+	webhook_t get(uint64_t channel_id);
+
+	/* Returns true if the channel's webhook was confirmed within WEBHOOK_VALIDATE_TTL seconds */
+	bool valid(uint64_t channel_id);
+
+	/* Record that Discord has confirmed, or just created, a channel's webhook */
+	void validated(uint64_t channel_id, uint64_t webhook_id, const std::string &url);
+
+	/* Forget a channel's webhook after Discord says it no longer exists. Does nothing if the channel
+	 * has since been given a different webhook.
+	 */
+	void invalidate(uint64_t channel_id, const std::string &url);
+};
@@ -26,6 +26,7 @@
 #include <string>
 #include <sstream>
 #include <queue>
+#include <unordered_map>
 #include <cstdio>
 #include <iostream>
 #include <memory>
@@ -59,6 +60,8 @@ using json = nlohmann::json;
 #define START_STATUS 100
 #define END_STATUS 600
 #define FIRE_AND_FORGET_QUEUES 10
+/* Maximum number of content hashes kept by cache_user() before they are all forgotten */
+#define CACHE_HASH_MAX 1000000
 
 Bot* bot = nullptr;
 TriviaModule* module = nullptr;
@@ -68,6 +71,9 @@ std::mutex faflock[FIRE_AND_FORGET_QUEUES];
 std::mutex fafindex;
 std::mutex interfaceindex;
 std::mutex statsmutex;
+std::mutex cachehash_mutex;
+/* Hash of what cache_user() last wrote for each user, guild, membership and guild role set */
+std::unordered_map<uint64_t, uint64_t> cache_hashes;
 std::mutex rlmutex;
 
 uint32_t faf_index = 0;
@@ -279,14 +285,9 @@ std::string web_request(const std::string &_host, const std::string &_path, cons
 					if (bot) {
 						bot->core->log(dpp::ll_warning, fmt::format("HTTP Error {} on POST {}/{} (channel_id={})", res->status, _host, _path, channel_id));
 						if (res->status == 404) {
-							{
-								std::unique_lock lock(module->wh_mutex);
-								auto i = module->webhooks.find(channel_id);
-								if (i != module->webhooks.end()) {
-									module->webhooks.erase(i);
-								}
-							}
-							db::backgroundquery("DELETE FROM channel_webhooks WHERE channel_id = ?", {channel_id});
+							/* The webhook has been deleted. Only forget it if it is still the one for this channel */
+							module->webhooks->invalidate(channel_id, _host + _path);
+							db::backgroundquery("DELETE FROM channel_webhooks WHERE channel_id = ? AND webhook = '?'", {channel_id, _host + _path});
 						}
 					}
 				}
@@ -414,6 +415,31 @@ std::vector<std::string> to_list(const std::string &str)
 	return response;
 }
 
+/* Returns true if the content cached under a key has changed since it was last written, and remembers it */
+static bool cache_changed(const std::string &key, const std::string &content)
+{
+	uint64_t k = std::hash<std::string>{}(key);
+	uint64_t h = std::hash<std::string>{}(content);
+	std::lock_guard<std::mutex> lock(cachehash_mutex);
+	auto i = cache_hashes.find(k);
+	if (i != cache_hashes.end() && i->second == h) {
+		return false;
+	}
+	if (cache_hashes.size() >= CACHE_HASH_MAX) {
+		cache_hashes.clear();
+	}
+	cache_hashes[k] = h;
+	return true;
+}
+
+/* Forget what was cached for a guild, so that it is written again if the bot rejoins */
+void forget_cached_guild(uint64_t guild_id)
+{
+	uint64_t k = std::hash<std::string>{}(fmt::format("guild {}", guild_id));
+	std::lock_guard<std::mutex> lock(cachehash_mutex);
+	cache_hashes.erase(k);
+}
+
 /* Store details about a user to the database. Executes when the user successfully answers a question, or when they issue a valid command */
 void cache_user(const dpp::user *_user, const dpp::guild *_guild, const dpp::guild_member* gi)
 {
@@ -422,65 +448,89 @@ void cache_user(const dpp::user *_user, const dpp::guild *_guild, const dpp::gui
 	uint64_t user_id = _user->id;
 	uint64_t guild_id = _guild->id;
 
-	db::backgroundquery("INSERT INTO trivia_user_cache (snowflake_id, username, discriminator, icon) VALUES('?', '?', '?', '?') ON DUPLICATE KEY UPDATE username = '?', discriminator = '?', icon = '?'",
-			{user_id, _user->username, _user->discriminator, _user->avatar.to_string(), _user->username, _user->discriminator, _user->avatar.to_string()});
+	if (cache_changed(fmt::format("user {}", user_id), fmt::format("{}\n{}\n{}", _user->username, _user->discriminator, _user->avatar.to_string()))) {
+		db::backgroundquery("INSERT INTO trivia_user_cache (snowflake_id, username, discriminator, icon) VALUES('?', '?', '?', '?') ON DUPLICATE KEY UPDATE username = '?', discriminator = '?', icon = '?'",
+				{user_id, _user->username, _user->discriminator, _user->avatar.to_string(), _user->username, _user->discriminator, _user->avatar.to_string()});
+	}
 
-	db::backgroundquery("INSERT INTO trivia_guild_cache (snowflake_id, name, icon, owner_id) VALUES('?', '?', '?', '?') ON DUPLICATE KEY UPDATE name = '?', icon = '?', owner_id = '?', kicked = 0",
-			{guild_id, _guild->name, _guild->icon.to_string(),  _guild->owner_id, _guild->name, _guild->icon.to_string(),  _guild->owner_id});
+	if (cache_changed(fmt::format("guild {}", guild_id), fmt::format("{}\n{}\n{}", _guild->name, _guild->icon.to_string(), _guild->owner_id))) {
+		db::backgroundquery("INSERT INTO trivia_guild_cache (snowflake_id, name, icon, owner_id) VALUES('?', '?', '?', '?') ON DUPLICATE KEY UPDATE name = '?', icon = '?', owner_id = '?', kicked = 0",
+				{guild_id, _guild->name, _guild->icon.to_string(),  _guild->owner_id, _guild->name, _guild->icon.to_string(),  _guild->owner_id});
+	}
 
 	std::string member_roles;
-	std::string comma_roles;
 	for (auto r = gi->roles.begin();r != gi->roles.end(); ++r) {
 		member_roles.append(std::to_string(*r)).append(" ");
 	}
 	member_roles = trim(member_roles);
-	db::backgroundquery("INSERT INTO trivia_guild_membership (guild_id, user_id, roles) VALUES('?', '?', '?') ON DUPLICATE KEY UPDATE roles = '?'",
-			{guild_id, user_id, member_roles, member_roles});
+	if (cache_changed(fmt::format("member {} {}", guild_id, user_id), member_roles)) {
+		db::backgroundquery("INSERT INTO trivia_guild_membership (guild_id, user_id, roles) VALUES('?', '?', '?') ON DUPLICATE KEY UPDATE roles = '?'",
+				{guild_id, user_id, member_roles, member_roles});
+	}
 
+	std::string comma_roles;
+	std::string role_values;
+	std::string role_content;
+	db::paramlist role_params;
 	for (auto n = _guild->roles.begin(); n != _guild->roles.end(); ++n) {
 		dpp::role* r = dpp::find_role(*n);
 		if (r) {
 			comma_roles.append(std::to_string(r->id)).append(",");
-			db::backgroundquery("INSERT INTO trivia_role_cache (id, guild_id, colour, permissions, position, hoist, managed, mentionable, name) VALUES('?', '?', '?', '?', '?', '?', '?', '?', '?') ON DUPLICATE KEY UPDATE colour = '?', permissions = '?', position = '?', hoist = '?', managed = '?', mentionable = '?', name = '?'",
-			{
-				r->id, guild_id, r->colour, r->permissions, r->position, (r->is_hoisted() ? 1 : 0), (r->is_managed() ? 1 : 0), (r->is_mentionable() ? 1 : 0), r->name,
-				r->colour, r->permissions, r->position, (r->is_hoisted() ? 1 : 0), (r->is_managed() ? 1 : 0), (r->is_mentionable() ? 1 : 0), r->name
-			});
+			role_values.append(role_values.empty() ? "" : ",").append("('?', '?', '?', '?', '?', '?', '?', '?', '?')");
+			role_content.append(fmt::format("{} {} {} {} {} {} {}\n{}\n", r->id, r->colour, r->permissions, r->position, r->is_hoisted(), r->is_managed(), r->is_mentionable(), r->name));
+			role_params.insert(role_params.end(), { r->id, guild_id, r->colour, r->permissions, r->position, (r->is_hoisted() ? 1 : 0), (r->is_managed() ? 1 : 0), (r->is_mentionable() ? 1 : 0), r->name });
 		}
 	}
+	if (role_values.empty() || !cache_changed(fmt::format("roles {}", guild_id), role_content)) {
+		return;
+	}
+	/* All of the guild's roles go in one statement */
+	db::backgroundquery("INSERT INTO trivia_role_cache (id, guild_id, colour, permissions, position, hoist, managed, mentionable, name) VALUES " + role_values + " ON DUPLICATE KEY UPDATE colour = VALUES(colour), permissions = VALUES(permissions), position = VALUES(position), hoist = VALUES(hoist), managed = VALUES(managed), mentionable = VALUES(mentionable), name = VALUES(name)", role_params);
 	comma_roles = trim(comma_roles.substr(0, comma_roles.length() - 1));
 	/* Delete any that have been deleted from discord */
 	db::backgroundquery("DELETE FROM trivia_role_cache WHERE guild_id = ? AND id NOT IN (" + comma_roles + ")", {guild_id});
 }
 
+/* Returns the query selecting questions in the given language, up to its WHERE clause on questions.id.
+ * The question's id is also selected as question_id, as the joined tables have id columns of their own.
+ */
+static std::string question_query(const std::string &language)
+{
+	if (language == "en") {
+		return "select questions.*, ans1.*, hin1.*, sta1.*, cat1.name as catname, questions.id as question_id from questions left join hints as hin1 on questions.id=hin1.id left join answers as ans1 on questions.id=ans1.id left join stats as sta1 on questions.id=sta1.id left join categories as cat1 on questions.category=cat1.id where questions.id";
+	} else {
+		return "select questions.trans_" + language + " as question, ans1.trans_" + language + " as answer, hin1.trans1_" + language + " as hint1, hin1.trans2_" + language + " as hint2, question_img_url, questions.guild_id, answer_img_url, sta1.*, cat1.trans_" + language + " as catname, questions.id as question_id from questions left join hints as hin1 on questions.id=hin1.id left join answers as ans1 on questions.id=ans1.id left join stats as sta1 on questions.id=sta1.id left join categories as cat1 on questions.category=cat1.id where questions.id";
+	}
+}
+
+static question_t question_from_row(db::row &question)
+{
+	return question_t(
+		from_string<uint64_t>(question["id"], std::dec),
+		question["guild_id"].empty() ? 0 : from_string<uint64_t>(question["guild_id"], std::dec),
+		homoglyph(question["question"]),
+		question["answer"],
+		question["hint1"],
+		question["hint2"],
+		question["catname"],
+		from_string<time_t>(question["lastasked"], std::dec),
+		from_string<uint32_t>(question["timesasked"], std::dec),
+		question["lastcorrect"],
+		from_string<double>(question["record_time"], std::dec),
+		utf8shuffle(question["answer"]),
+		utf8shuffle(question["answer"]),
+		question["question_img_url"],
+		question["answer_img_url"]
+	);
+}
+
 /* Fetch a question by ID from the database */
 question_t question_t::fetch(uint64_t id, uint64_t guild_id, const guild_settings_t &settings)
 {
 	try {
-		db::resultset question;
-		if (settings.language == "en") {
-			question = db::query("select questions.*, ans1.*, hin1.*, sta1.*, cat1.name as catname from questions left join hints as hin1 on questions.id=hin1.id left join answers as ans1 on questions.id=ans1.id left join stats as sta1 on questions.id=sta1.id left join categories as cat1 on questions.category=cat1.id where questions.id = ?", {id});
-		} else {
-			question = db::query("select questions.trans_" + settings.language + " as question, ans1.trans_" + settings.language + " as answer, hin1.trans1_" + settings.language + " as hint1, hin1.trans2_" + settings.language + " as hint2, question_img_url, questions.guild_id, answer_img_url, sta1.*, cat1.trans_" + settings.language + " as catname from questions left join hints as hin1 on questions.id=hin1.id left join answers as ans1 on questions.id=ans1.id left join stats as sta1 on questions.id=sta1.id left join categories as cat1 on questions.category=cat1.id where questions.id = ?", {id});
-		}
+		db::resultset question = db::query(question_query(settings.language) + " = ?", {id});
 		if (question.size() > 0) {
-				return question_t(
-				from_string<uint64_t>(question[0]["id"], std::dec),
-				question[0]["guild_id"].empty() ? 0 : from_string<uint64_t>(question[0]["guild_id"], std::dec),
-				homoglyph(question[0]["question"]),
-				question[0]["answer"],
-				question[0]["hint1"],
-				question[0]["hint2"],
-				question[0]["catname"],
-				from_string<time_t>(question[0]["lastasked"], std::dec),
-				from_string<uint32_t>(question[0]["timesasked"], std::dec),
-				question[0]["lastcorrect"],
-				from_string<double>(question[0]["record_time"], std::dec),
-				utf8shuffle(question[0]["answer"]),
-				utf8shuffle(question[0]["answer"]),
-				question[0]["question_img_url"],
-				question[0]["answer_img_url"]
-			);
+			return question_from_row(question[0]);
 		}
 	}
 	catch (const std::exception &e) {
@@ -493,6 +543,42 @@ question_t question_t::fetch(uint64_t id, uint64_t guild_id, const guild_setting
 	return question_t();
 }
 
+/* Fetch a list of questions by ID from the database, QUESTION_FETCH_CHUNK per query. The result is in
+ * the same order as the ids, with an empty question_t for any id which could not be fetched.
+ */
+std::vector<question_t> question_t::fetch_many(const std::vector<std::string> &ids, uint64_t guild_id, const guild_settings_t &settings)
+{
+	std::unordered_map<uint64_t, question_t> found;
+	try {
+		for (size_t chunk = 0; chunk < ids.size(); chunk += QUESTION_FETCH_CHUNK) {
+			db::paramlist params;
+			std::string placeholders;
+			for (size_t i = chunk; i < ids.size() && i < chunk + QUESTION_FETCH_CHUNK; ++i) {
+				params.push_back(from_string<uint64_t>(ids[i], std::dec));
+				placeholders += (placeholders.empty() ? "?" : ",?");
+			}
+			db::resultset questions = db::query_ro(question_query(settings.language) + " IN (" + placeholders + ")", params);
+			for (auto& q : questions) {
+				found.emplace(from_string<uint64_t>(q["question_id"], std::dec), question_from_row(q));
+			}
+		}
+	}
+	catch (const std::exception &e) {
+		if (bot) {
+			bot->core->log(dpp::ll_error, fmt::format("Exception: {}", e.what()));
+		} else {
+			std::cout << "Exception: " << e.what() << std::endl;
+		}
+	}
+	std::vector<question_t> list;
+	list.reserve(ids.size());
+	for (auto& id : ids) {
+		auto q = found.find(from_string<uint64_t>(id, std::dec));
+		list.emplace_back(q != found.end() ? q->second : question_t());
+	}
+	return list;
+}
+
 
 std::vector<std::string> EnumCommandsDir()
 {
@@ -566,11 +652,11 @@ void runcli(guild_settings_t settings, const std::string &command, uint64_t guil
 
 	/* IMPORTANT: dpp::utility::exec makes parameters safe */
 	dpp::utility::exec("/usr/bin/php", { fmt::format("{}/www/cli-run.php", home), command, std::to_string(guild_id), std::to_string(user_id), std::to_string(channel_id), parameters }, [channel_id, guild_id, interaction_token, command_id](const std::string &output) {
-		guild_settings_t s = module->GetGuildSettings(guild_id);
+		guild_settings_ptr s = module->GetGuildSettings(guild_id);
 		/* Output response as embed */
 		std::string reply = trim(output);
 		if (!reply.empty()) {
-			module->ProcessEmbed(interaction_token, command_id, s, reply, channel_id);
+			module->ProcessEmbed(interaction_token, command_id, *s, reply, channel_id);
 		} else if (!interaction_token.empty()) {
 			/* Empty reply but handled. delete "thinking" notification */
 			bot->core->post_rest(API_PATH "/webhooks", std::to_string(bot->core->me.id), dpp::utility::url_encode(interaction_token) + "/messages/@original", dpp::m_delete, "", [&](auto& json, auto& request) {}, "", "");
@@ -594,6 +680,7 @@ void update_score_only(uint64_t snowflake_id, uint64_t guild_id, int score, uint
 			{snowflake_id, guild_id, score, score, score, score, score, score, score, score});
 	db::backgroundquery("INSERT INTO global_scores (name, score, dayscore, weekscore, monthscore) VALUES('?', '?', '?', '?', '?') ON DUPLICATE KEY UPDATE score = score + ?, weekscore = weekscore + ?, monthscore = monthscore + ?, dayscore = dayscore + ?",
 			{snowflake_id, score, score, score, score, score, score, score, score});
+	module->ranks->add_score(snowflake_id, score);
 	db::backgroundquery("INSERT INTO scores_lastgame (guild_id, user_id, score) VALUES('?', '?', '?') ON DUPLICATE KEY UPDATE score = score + ?", {guild_id, snowflake_id, score, score});
 	db::backgroundquery("INSERT INTO insane_round_statistics (guild_id, channel_id, user_id, score) VALUES('?', '?', '?', '?') ON DUPLICATE KEY UPDATE score = score + ?", {guild_id, channel_id, snowflake_id, score, score});
 }
@@ -625,9 +712,14 @@ void log_game_end(uint64_t guild_id, uint64_t channel_id)
 	hostname[1023] = '\0';
 	gethostname(hostname, 1023);
 	
-	/* Obtain and delete the active game entry */
+	module->checkpoints->remove(channel_id);
+
+	/* Obtain and delete the active game entry. The delete isn't backgrounded, the dashboard's stop flag
+	 * must be gone from the database before the stop request is cleared, or the next poll brings it back.
+	 */
 	db::resultset gameinfo = db::query("SELECT * FROM active_games WHERE guild_id = '?' AND channel_id = '?' AND hostname = '?'", {guild_id, channel_id, std::string(hostname)});
-	db::backgroundquery("DELETE FROM active_games WHERE guild_id = '?' AND channel_id = '?' AND hostname = '?'", {guild_id, channel_id, std::string(hostname)});
+	db::query("DELETE FROM active_games WHERE guild_id = '?' AND channel_id = '?' AND hostname = '?'", {guild_id, channel_id, std::string(hostname)});
+	module->ClearStopRequest(channel_id);
 
 	/* Collate the last game's scores into JSON for storage in the database for the stats pages */
 	db::resultset lastgame = db::query("SELECT * FROM scores_lastgame WHERE guild_id = '?'",{guild_id});
@@ -647,12 +739,6 @@ void log_game_end(uint64_t guild_id, uint64_t channel_id)
 /* Update current question of a game, used for resuming games on crash or restart, plus the dashboard active games list */
 bool log_question_index(uint64_t guild_id, uint64_t channel_id, uint32_t index, uint32_t streak, uint64_t lastanswered, uint32_t state, uint32_t qid)
 {
-	char hostname[1024];
-	hostname[1023] = '\0';
-	gethostname(hostname, 1023);
-
-	uint32_t cluster_id = bot->GetClusterID();
-	guild_settings_t settings = module->GetGuildSettings(guild_id);
 	bool should_stop = false;
 
 	{
@@ -664,17 +750,14 @@ bool log_question_index(uint64_t guild_id, uint64_t channel_id, uint32_t index,
 		module->last_channel_streaks[channel_id] = t;
 	}
 
-	/* Update game details */
-	db::backgroundquery("UPDATE active_games SET cluster_id = '?', question_index = '?', streak = '?', lastanswered = '?', state = '?' WHERE guild_id = '?' AND channel_id = '?' AND hostname = '?'",
-			{cluster_id, index, streak, lastanswered, state, guild_id, channel_id, std::string(hostname)});
+	/* Update game details locally, TriviaModule::FlushCheckpoints() sends them on to the database */
+	module->checkpoints->update({guild_id, channel_id, lastanswered, time(NULL), index, streak, state, 0});
 
 	/* Check if the dashboard has stopped this game */
-	db::resultset st = db::query("SELECT stop FROM active_games WHERE guild_id = '?' AND channel_id = '?' AND hostname = '?' AND stop = 1", {guild_id, channel_id, std::string(hostname)});
-	should_stop = (st.size() > 0);
+	should_stop = module->StopRequested(channel_id);
 
 	if (state == TRIV_ASK_QUESTION) {
-		db::backgroundquery("UPDATE counters SET asked_15_min = asked_15_min + 1", {});
-		db::backgroundquery("UPDATE categories inner join questions on questions.category = categories.id SET questions_asked = questions_asked + 1 WHERE questions.id = ?", {qid});
+		module->CountQuestionAsked(qid);
 	}
 
 	return should_stop;
@@ -690,6 +773,7 @@ uint32_t update_score(uint64_t snowflake_id, uint64_t guild_id, double recordtim
 	if (!local_only) {
 		db::backgroundquery("INSERT INTO global_scores (name, score, dayscore, weekscore, monthscore) VALUES('?', '?', '?', '?', '?') ON DUPLICATE KEY UPDATE score = score + ?, weekscore = weekscore + ?, monthscore = monthscore + ?, dayscore = dayscore + ?",
 			{snowflake_id, score, score, score, score, score, score, score, score});
+		module->ranks->add_score(snowflake_id, score);
 	}
 	db::backgroundquery("INSERT INTO scores_lastgame (guild_id, user_id, score) VALUES('?', '?', '?') ON DUPLICATE KEY UPDATE score = score + ?", {guild_id, snowflake_id, score, score});
 
@@ -707,6 +791,9 @@ uint32_t get_total_questions()
 /* Return the current team name for a player, or an empty string */
 std::string get_current_team(uint64_t snowflake_id)
 {
+	if (module->teams->ready()) {
+		return module->teams->get_team(snowflake_id);
+	}
 	// Replaced with direct db query for perforamance increase - 27Dec20
 	db::resultset r = db::query("SELECT team FROM team_membership WHERE nick = '?'", {snowflake_id});
 	if (r.size()) {
@@ -721,30 +808,44 @@ void leave_team(uint64_t snowflake_id)
 {
 	// Replaced with direct db query for perforamance increase - 27Dec20
 	db::query("DELETE FROM team_membership WHERE nick = '?'", {snowflake_id});
+	module->teams->left(snowflake_id);
 }
 
 /* Make a player join a team */
 bool join_team(uint64_t snowflake_id, const std::string &team, uint64_t channel_id)
 {
-	if (check_team_exists(team)) {
-		auto teaminfo = db::query("SELECT * FROM teams WHERE name = '?'", {team});
-		if (teaminfo.size() && teaminfo[0]["qualifying_score"].length() && from_string<uint64_t>(teaminfo[0]["qualifying_score"], std::dec) > 0) {
-			auto rs_score = db::query("SELECT * FROM vw_scorechart WHERE name = '?'", {team});
+	db::transaction t;
+	std::string name = team;
+	if (join_team(snowflake_id, name, channel_id, t) && t.commit()) {
+		module->teams->joined(snowflake_id, name);
+		return true;
+	}
+	return false;
+}
+
+/* Join a team as part of a larger transaction. The caller must commit the transaction.
+ * Names match without case, so team is changed to the name as it is stored in the teams table.
+ */
+bool join_team(uint64_t snowflake_id, std::string &team, uint64_t channel_id, db::transaction &t)
+{
+	auto teaminfo = t.query("SELECT * FROM teams WHERE name = '?' FOR UPDATE", {team});
+	if (teaminfo.size()) {
+		team = teaminfo[0]["name"];
+		if (teaminfo[0]["qualifying_score"].length() && from_string<uint64_t>(teaminfo[0]["qualifying_score"], std::dec) > 0) {
+			/* Read on the transaction's own connection, a second checkout while holding it could exhaust the pool */
+			auto rs_score = t.query("SELECT * FROM vw_scorechart WHERE name = '?'", {team});
 			uint64_t score = (rs_score.size() ? from_string<uint64_t>(rs_score[0]["score"], std::dec) : 0);
 			if (score < from_string<uint64_t>(teaminfo[0]["qualifying_score"], std::dec)) {
 				throw JoinNotQualifiedException(score, from_string<uint64_t>(teaminfo[0]["qualifying_score"], std::dec));
 			}
 		}
-		auto rs = db::query("SELECT team FROM team_membership WHERE nick='?'", {snowflake_id});
-		if (rs.size()) {
-			for (auto& t : rs) {
-				db::backgroundquery("UPDATE teams SET owner_id = '?' WHERE name = '?' AND owner_id IS NULL", {snowflake_id, team});
-				return true;
-			}
+		auto rs = t.query("SELECT team FROM team_membership WHERE nick='?'", {snowflake_id});
+		if (rs.empty()) {
+			/* Membership changes are sent to the database together in one round trip on commit */
+			t.add("DELETE FROM team_membership WHERE nick='?'", {snowflake_id});
+			t.add("INSERT INTO team_membership (nick, team, joined, points_contributed) VALUES('?','?',now(),0)", {snowflake_id, team});
 		}
-		db::query("DELETE FROM team_membership WHERE nick='?'", {snowflake_id});
-		db::query("INSERT INTO team_membership (nick, team, joined, points_contributed) VALUES('?','?',now(),0)", {snowflake_id, team});
-		db::query("UPDATE teams SET owner_id = '?' WHERE name = '?' AND owner_id IS NULL", {snowflake_id, team});
+		t.add("UPDATE teams SET owner_id = '?' WHERE name = '?' AND owner_id IS NULL", {snowflake_id, team});
 		return true;
 	} else {
 		return false;
@@ -754,59 +855,34 @@ bool join_team(uint64_t snowflake_id, const std::string &team, uint64_t channel_
 /* Update the streak for a player on a guild */
 void change_streak(uint64_t snowflake_id, uint64_t guild_id, int score)
 {
-	db::backgroundquery("INSERT INTO streaks (nick, guild_id, streak) VALUES('?','?','?') ON DUPLICATE KEY UPDATE streak='?'", {snowflake_id, guild_id, score, score});
+	module->streaks->set(snowflake_id, guild_id, score);
 	check_achievement("streak", snowflake_id, guild_id);
 }
 
 /* Get the current streak details for a player on a guild, and the best streak for the guild at present */
 streak_t get_streak(uint64_t snowflake_id, uint64_t guild_id)
 {
-	// Replaced with direct db query for perforamance increase - 27Dec20
-	streak_t s;
-	db::resultset streak = db::query("SELECT nick, streak FROM streaks WHERE guild_id = '?' ORDER BY streak DESC LIMIT 1", {guild_id});
-	db::resultset ss2 = db::query("SELECT streak FROM streaks WHERE nick='?' AND guild_id = '?'", {snowflake_id, guild_id});
-	s.personalbest = 0;
-	s.topstreaker = 0;
-	s.bigstreak = 9999999;
-	if (ss2.size() > 0) {
-		s.personalbest = from_string<uint32_t>(ss2[0]["streak"], std::dec);
-	}
-	if (streak.size() > 0) {
-		s.topstreaker = from_string<uint64_t>(streak[0]["nick"], std::dec);
-		s.bigstreak = from_string<uint32_t>(streak[0]["streak"], std::dec);
-	}
-	return s;
+	return module->streaks->get(snowflake_id, guild_id);
 }
 
-/* Update the streak for a player on a guild */
+/* Update the global streak for a player */
 void change_streak(uint64_t snowflake_id, int score)
 {
-	db::backgroundquery("INSERT INTO global_streaks (nick, streak) VALUES('?','?') ON DUPLICATE KEY UPDATE streak='?'", {snowflake_id, score, score});
+	module->streaks->set(snowflake_id, score);
 }
 
-/* Get the current streak details for a player on a guild, and the best streak for the guild at present */
+/* Get the current global streak details for a player, and the best global streak at present */
 streak_t get_streak(uint64_t snowflake_id)
 {
-	// Replaced with direct db query for perforamance increase - 27Dec20
-	streak_t s;
-	db::resultset streak = db::query("SELECT nick, streak FROM global_streaks ORDER BY streak DESC LIMIT 1", {});
-	db::resultset ss2 = db::query("SELECT streak FROM global_streaks WHERE nick='?'", {snowflake_id});
-	s.personalbest = 0;
-	s.topstreaker = 0;
-	s.bigstreak = 9999999;
-	if (ss2.size() > 0) {
-		s.personalbest = from_string<uint32_t>(ss2[0]["streak"], std::dec);
-	}
-	if (streak.size() > 0) {
-		s.topstreaker = from_string<uint64_t>(streak[0]["nick"], std::dec);
-		s.bigstreak = from_string<uint32_t>(streak[0]["streak"], std::dec);
-	}
-	return s;
+	return module->streaks->get(snowflake_id);
 }
 
 /* Returns true if a team name exists */
 bool check_team_exists(const std::string &team)
 {
+	if (module->teams->ready()) {
+		return module->teams->exists(team);
+	}
 	// Replaced with direct db query for perforamance increase - 27Dec20
 	db::resultset r = db::query("SELECT name FROM teams WHERE name = '?'", {team});
 	return (r.size());
@@ -817,6 +893,7 @@ void add_team_points(const std::string &team, int points, uint64_t snowflake_id)
 {
 	// Replaced with direct db query for perforamance increase - 27Dec20
 	db::backgroundquery("UPDATE teams SET score = score + ? WHERE name = '?'", {points, team});
+	module->teams->add_points(team, points);
 	if (snowflake_id) {
 		db::backgroundquery("UPDATE team_membership SET points_contributed = points_contributed + ? WHERE nick = '?'", {points, snowflake_id});
 	}
@@ -826,6 +903,9 @@ void add_team_points(const std::string &team, int points, uint64_t snowflake_id)
 /* Get the points of a team */
 uint32_t get_team_points(const std::string &team)
 {
+	if (module->teams->ready()) {
+		return module->teams->get_points(team);
+	}
 	// Replaced with direct db query for performance increase - 27Dec20
 	db::resultset r = db::query("SELECT score FROM teams WHERE name = '?'", {team});
 	if (r.size()) {
@@ -840,21 +920,27 @@ void check_create_webhook(const guild_settings_t & s, TriviaModule* t, uint64_t
 	/* Create new webhook for a channel, or update existing webhook.
 	 * Store webhook details to database for future use.
 	 * This function checks the existing webhook is usable and if not, creates a new one.
+	 * A webhook Discord has confirmed within WEBHOOK_VALIDATE_TTL seconds is not checked again.
 	 */
 	dpp::cluster* c = t->GetBot()->core;
 
+	if (t->webhooks->valid(channel_id)) {
+		return;
+	}
+
 	c->log(dpp::ll_debug, fmt::format("Create or update webhook for channel {}", channel_id));
 
-	auto create_wh = [c, channel_id]() {
+	auto create_wh = [c, t, channel_id]() {
 		dpp::webhook wh;
 		wh.name = "TriviaBot";
 		wh.channel_id = channel_id;
 		wh.load_image(WEBHOOK_ICON, dpp::i_png, true);
-		c->create_webhook(wh, [channel_id, c](const dpp::confirmation_callback_t& data) {
+		c->create_webhook(wh, [channel_id, c, t](const dpp::confirmation_callback_t& data) {
 			if (!data.is_error()) {
 				dpp::webhook new_wh = std::get<dpp::webhook>(data.value);
 				std::string url = "https://discord.com/api/webhooks/" + std::to_string(new_wh.id) + "/" + dpp::utility::url_encode(new_wh.token);
 				db::query("INSERT INTO channel_webhooks (channel_id, webhook_id, webhook) VALUES('?','?','?') ON DUPLICATE KEY UPDATE webhook_id = '?', webhook = '?'", {new_wh.channel_id, new_wh.id, url, new_wh.id, url});
+				t->webhooks->validated(channel_id, new_wh.id, url);
 				c->log(dpp::ll_debug, fmt::format("New webhook created for channel {}: {}", channel_id, new_wh.id));
 			} else {
 				c->log(dpp::ll_debug, fmt::format("Error creating webhook for channel {}: {}", channel_id, data.get_error().message));
@@ -862,21 +948,18 @@ void check_create_webhook(const guild_settings_t & s, TriviaModule* t, uint64_t
 		});
 	};
 
-	db::resultset existing_hook = db::query("SELECT * FROM channel_webhooks WHERE channel_id = '?'", {channel_id});
-	if (existing_hook.size()) {
+	webhook_t existing_hook = t->webhooks->get(channel_id);
+	if (existing_hook.id) {
 		c->log(dpp::ll_debug, fmt::format("Existing webhook found for channel {}", channel_id));
 		/* Check if existing webhook is still valid */
-		uint64_t wid = 0;
-		try {
-			wid = std::stoull(existing_hook[0]["webhook_id"]);
-		}
-		catch (const std::exception&) {
-			wid = 0;
-		}
-		c->get_webhook(wid, [create_wh, channel_id, c](const dpp::confirmation_callback_t& data) {
+		c->get_webhook(existing_hook.id, [create_wh, existing_hook, channel_id, c, t](const dpp::confirmation_callback_t& data) {
 			if (!data.is_error()) {
 				dpp::webhook existing_wh = std::get<dpp::webhook>(data.value);
-				db::backgroundquery("UPDATE channel_webhooks SET webhook = '?' WHERE webhook_id = '?' AND channel_id = '?'", {"https://discord.com/api/webhooks/" + std::to_string(existing_wh.id) + "/" + dpp::utility::url_encode(existing_wh.token), existing_wh.id, existing_wh.channel_id});
+				std::string url = "https://discord.com/api/webhooks/" + std::to_string(existing_wh.id) + "/" + dpp::utility::url_encode(existing_wh.token);
+				if (url != existing_hook.url) {
+					db::backgroundquery("UPDATE channel_webhooks SET webhook = '?' WHERE webhook_id = '?' AND channel_id = '?'", {url, existing_wh.id, existing_wh.channel_id});
+				}
+				t->webhooks->validated(channel_id, existing_wh.id, url);
 				c->log(dpp::ll_debug, fmt::format("Existing webhook still valid for channel {}", channel_id));
 				return;
 			} else {
@@ -23,6 +23,7 @@
 #pragma once
 #include <dpp/dpp.h>
 #include <string>
+#include <sporks/database.h>
 #include "trivia.h"
 
 /* Live API endpoint URL */
@@ -83,12 +84,14 @@ bool check_team_exists(const std::string &team);
 void add_team_points(const std::string &team, int points, uint64_t snowflake_id);
 uint32_t get_team_points(const std::string &team);
 void cache_user(const class dpp::user *_user, const class dpp::guild *_guild, const class dpp::guild_member* gi);
+void forget_cached_guild(uint64_t guild_id);
 bool log_question_index(uint64_t guild_id, uint64_t channel_id, uint32_t index, uint32_t streak, uint64_t lastanswered, uint32_t state, uint32_t qid);
 void log_game_start(uint64_t guild_id, uint64_t channel_id, uint64_t number_questions, bool quickfire, const std::string &channel_name, uint64_t user_id, const std::vector<std::string> &questions, bool hintless);
 void log_game_end(uint64_t guild_id, uint64_t channel_id);
 void change_streak(uint64_t snowflake_id, uint64_t guild_id, int score);
 void change_streak(uint64_t snowflake_id, int score);
 bool join_team(uint64_t snowflake_id, const std::string &team, uint64_t channel_id);
+bool join_team(uint64_t snowflake_id, std::string &team, uint64_t channel_id, db::transaction &t);
 void check_create_webhook(const guild_settings_t & s, TriviaModule* t, uint64_t channel_id);
 std::vector<std::string> get_api_command_names();
 
@@ -0,0 +1,19 @@
+-- Changes to apply to a database created from an older triviabot-client.sql.
+-- Each step is safe to run on a database which already has it.
+
+-- Guild settings change polling
+ALTER TABLE `bot_guild_settings`
+  ADD COLUMN IF NOT EXISTS `updated_at` timestamp(3) NOT NULL DEFAULT current_timestamp(3) ON UPDATE current_timestamp(3) COMMENT 'Time of last change, used by the bot to refresh its settings cache',
+  ADD KEY IF NOT EXISTS `updated_at` (`updated_at`);
+
+-- Ban list change polling
+ALTER TABLE `bans`
+  ADD COLUMN IF NOT EXISTS `updated_at` timestamp(3) NOT NULL DEFAULT current_timestamp(3) ON UPDATE current_timestamp(3) COMMENT 'Time of last change, used by the bot to refresh its ban list',
+  ADD KEY IF NOT EXISTS `updated_at` (`updated_at`);
+
+-- Coin ledger progress
+CREATE TABLE IF NOT EXISTS `coin_ledger_state` (
+  `cluster_id` int(10) UNSIGNED NOT NULL,
+  `last_seq` bigint(20) UNSIGNED NOT NULL COMMENT 'Sequence number of the last coin ledger entry written by this cluster',
+  PRIMARY KEY (`cluster_id`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COMMENT='Progress of each cluster''s coin ledger, so that no entry is written twice';
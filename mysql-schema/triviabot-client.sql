@@ -206,7 +206,8 @@ CREATE TABLE `bans` (
   `snowflake_id` bigint(20) UNSIGNED NOT NULL,
   `moderator_id` bigint(20) UNSIGNED NOT NULL,
   `reason` text NOT NULL,
-  `ban_date` datetime NOT NULL DEFAULT current_timestamp()
+  `ban_date` datetime NOT NULL DEFAULT current_timestamp(),
+  `updated_at` timestamp(3) NOT NULL DEFAULT current_timestamp(3) ON UPDATE current_timestamp(3) COMMENT 'Time of last change, used by the bot to refresh its ban list'
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
 
 CREATE TABLE `bot_guild_settings` (
@@ -228,7 +229,8 @@ CREATE TABLE `bot_guild_settings` (
   `max_normal_round` int(10) UNSIGNED DEFAULT NULL,
   `max_hardcore_round` int(10) UNSIGNED DEFAULT NULL,
   `max_quickfire_round` int(10) UNSIGNED DEFAULT NULL,
-  `disable_insane_rounds` tinyint(1) UNSIGNED NOT NULL DEFAULT 0
+  `disable_insane_rounds` tinyint(1) UNSIGNED NOT NULL DEFAULT 0,
+  `updated_at` timestamp(3) NOT NULL DEFAULT current_timestamp(3) ON UPDATE current_timestamp(3) COMMENT 'Time of last change, used by the bot to refresh its settings cache'
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COMMENT='Stores guild specific settings';
 
 CREATE TABLE `categories` (
@@ -268,6 +270,11 @@ CREATE TABLE `channel_whitelist` (
   `channel_id` bigint(20) UNSIGNED NOT NULL
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4;
 
+CREATE TABLE `coin_ledger_state` (
+  `cluster_id` int(10) UNSIGNED NOT NULL,
+  `last_seq` bigint(20) UNSIGNED NOT NULL COMMENT 'Sequence number of the last coin ledger entry written by this cluster'
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb4 COMMENT='Progress of each cluster''s coin ledger, so that no entry is written twice';
+
 CREATE TABLE `coins` (
   `user_id` bigint(20) UNSIGNED NOT NULL,
   `balance` bigint(20) UNSIGNED NOT NULL,
@@ -1149,10 +1156,12 @@ ALTER TABLE `answers`
 ALTER TABLE `bans`
   ADD PRIMARY KEY (`snowflake_id`),
   ADD KEY `moderator_id` (`moderator_id`),
-  ADD KEY `ban_date` (`ban_date`);
+  ADD KEY `ban_date` (`ban_date`),
+  ADD KEY `updated_at` (`updated_at`);
 
 ALTER TABLE `bot_guild_settings`
   ADD PRIMARY KEY (`snowflake_id`),
+  ADD KEY `updated_at` (`updated_at`),
   ADD UNIQUE KEY `custom_url` (`custom_url`),
   ADD KEY `premium` (`premium`),
   ADD KEY `only_mods_stop` (`only_mods_stop`),
@@ -1176,6 +1185,9 @@ ALTER TABLE `channel_whitelist`
   ADD PRIMARY KEY (`guild_id`,`channel_id`),
   ADD KEY `channel_id_idx` (`channel_id`);
 
+ALTER TABLE `coin_ledger_state`
+  ADD PRIMARY KEY (`cluster_id`);
+
 ALTER TABLE `coins`
   ADD PRIMARY KEY (`user_id`),
   ADD KEY `balance` (`balance`),
@@ -23,13 +23,24 @@
 #include <fmt/format.h>
 #include <sporks/database.h>
 #include <mysql/mysql.h>
+#include <mysql/errmsg.h>
 #include <iostream>
 #include <mutex>
 #include <sstream>
 #include <chrono>
 #include <thread>
 #include <queue>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <memory>
+#include <fstream>
 #include <dpp/dpp.h>
+#include <sporks/stringops.h>
 
 /* Initial connection string for the database.
  * Note that mariadb and mysql have differnet syntax (this is one of the few sitations where they differ).
@@ -42,6 +53,17 @@
 	#define CONNECT_STRING "SET NAMES utf8mb4, @@SESSION.max_execution_time=3000"
 #endif
 
+/* Replication status query and the column within it holding replica lag in seconds.
+ * Again these differ, mysql renamed them in 8.0.22 and removed the old names in 8.4.
+ */
+#ifdef MARIADB_VERSION_ID
+	#define REPLICA_STATUS "SHOW SLAVE STATUS"
+	#define REPLICA_LAG_FIELD "Seconds_Behind_Master"
+#else
+	#define REPLICA_STATUS "SHOW REPLICA STATUS"
+	#define REPLICA_LAG_FIELD "Seconds_Behind_Source"
+#endif
+
 using namespace std::literals;
 
 namespace db {
@@ -54,28 +76,124 @@ namespace db {
 		paramlist parameters;
 	};
 
-	/* Number of connections in the foreground thread pool.
+	/* Number of connections in the foreground thread pool, set by connect().
 	 * REMEMBER NOT TO GET TOO GREEDY!
 	 * This will be multiplied up by how many clusters are running!
 	 */
-	const size_t POOL_SIZE = 10;
+	size_t pool_size = DEFAULT_POOL_SIZE;
 
-	/* Current connection index for the foreground pool,
-	 * used for round-robin of the queries across connections.
+	/* Number of checkout wait times kept for percentile calculation */
+	const size_t WAIT_SAMPLES = 4096;
+
+	/* A set of connections to one server. Connections are checked out
+	 * exclusively by a single query at a time.
 	 */
-	size_t curr_index = 0;
+	struct pool {
+		/* All connections in the pool */
+		std::vector<sqlconn*> connections;
+
+		/* Indexes of idle connections. This is used as a stack, so
+		 * the most recently returned connection is handed out next.
+		 */
+		std::vector<size_t> idle;
+
+		/* Protects idle and the checkout wait samples */
+		std::mutex mutex;
 
-	/* Foreground connection pool */
-	sqlconn connections[POOL_SIZE];
+		/* Signalled whenever a connection is returned to the idle stack */
+		std::condition_variable cv;
+
+		/* Ring buffer of recent checkout wait times (seconds) */
+		double wait_samples[WAIT_SAMPLES];
+
+		/* Total checkouts, and checkouts which found no idle connection and had to wait */
+		uint64_t checkouts = 0;
+		uint64_t checkouts_waited = 0;
+
+		/* Longest checkout wait seen (seconds) */
+		double checkout_wait_max = 0.0;
+
+		/**
+		 * Take an idle connection, waiting on the condition variable if every
+		 * connection is currently checked out. Returns the index of the
+		 * connection, which must be given back via checkin().
+		 */
+		size_t checkout() {
+			double start = dpp::utility::time_f();
+			std::unique_lock<std::mutex> pool_lock(mutex);
+			if (idle.empty()) {
+				checkouts_waited++;
+				cv.wait(pool_lock, [this] { return !idle.empty(); });
+			}
+			size_t c = idle.back();
+			idle.pop_back();
+			connections[c]->busy = true;
+			double wait = dpp::utility::time_f() - start;
+			wait_samples[checkouts++ % WAIT_SAMPLES] = wait;
+			checkout_wait_max = std::max(checkout_wait_max, wait);
+			return c;
+		}
+
+		/**
+		 * Return a connection to the idle stack and wake one waiting caller
+		 */
+		void checkin(size_t c) {
+			{
+				std::lock_guard<std::mutex> pool_lock(mutex);
+				connections[c]->busy = false;
+				idle.push_back(c);
+			}
+			cv.notify_one();
+		}
+	};
+
+	/* Foreground connection pool to the primary server */
+	pool primary;
+
+	/* A read replica, used by db::query_ro() */
+	struct replica {
+		/* Hostname and port */
+		std::string host;
+		int port = 3306;
+		/* Connections to this replica */
+		pool connections;
+		/* Replication lag last reported by the replica (seconds) */
+		std::atomic<double> lag = 0.0;
+		/* False if the replica can't be reached or replication has stopped */
+		std::atomic<bool> healthy = false;
+		/* Queries routed to this replica */
+		std::atomic<uint64_t> queries = 0;
+	};
+
+	/* Read replicas, may be empty */
+	std::vector<replica*> replicas;
+
+	/* Round-robin counter for choosing a replica */
+	std::atomic<size_t> next_replica = 0;
+
+	/* Replicas lagging by more than this many seconds are not used */
+	double max_replica_lag = DEFAULT_MAX_REPLICA_LAG;
+
+	/* Read-only queries which had to fall back to the primary */
+	std::atomic<uint64_t> ro_fallbacks = 0;
+
+	/* Thread which checks replica health and lag */
+	std::thread* replica_thread = nullptr;
+
+	/* Credentials, shared by the primary and replicas */
+	std::string db_user, db_pass, db_name;
 
 	/* Background connection */
 	sqlconn bg_connection;
 
 	/* Total processed query counter */
-	uint64_t processed = 0;
+	std::atomic<uint64_t> processed = 0;
 	
 	/* Total errored queries counter */
-	uint64_t errored = 0;
+	std::atomic<uint64_t> errored = 0;
+
+	/* True if the last query()/query_ro() on this thread failed */
+	thread_local bool last_failed = false;
 
 	/* Protects the background_queries queue from concurrent access */
 	std::mutex b_db_mutex;
@@ -86,15 +204,304 @@ namespace db {
 	/* Thread upon which background queries will execute */
 	std::thread* background_thread = nullptr;
 
+	/* Represents a queued asynchronous query */
+	struct async_query {
+		/* Format string */
+		std::string format;
+		/* Unescaped parameters */
+		paramlist parameters;
+		/* Completion callback */
+		query_callback callback;
+		/* True if the query may be routed to a read replica */
+		bool read_only = false;
+		/* Owner given to db::cancel_async(), may be nullptr */
+		const void* owner = nullptr;
+	};
+
+	/* Protects async_queries */
+	std::mutex async_mutex;
+
+	/* Signalled when a query is added to async_queries */
+	std::condition_variable async_cv;
+
+	/* Queue of asynchronous queries waiting for a pool thread */
+	std::deque<async_query> async_queries;
+
+	/* Owners of the asynchronous queries being run or called back right now, protected by async_mutex */
+	std::unordered_multiset<const void*> async_running;
+
+	/* Signalled when an asynchronous query and its callback have finished */
+	std::condition_variable async_done_cv;
+
+	/* Pool threads which execute asynchronous queries, one per foreground connection */
+	std::vector<std::thread*> async_threads;
+
 	/* spdlog logger */
 	dpp::cluster* log;
 
+	/* Log-linear (HDR style) histogram of unsigned values.
+	 *
+	 * Values below 16 have a bucket each. Above that every power of two is split
+	 * into 16 linear sub-buckets, so any recorded value is reported within about
+	 * 6% of its true value. Values above 2^40 are clamped. Buckets are atomic
+	 * counters so recording never takes a lock; percentiles read while another
+	 * thread is recording may be very slightly stale, which is fine for stats.
+	 */
+	class histogram {
+		static const size_t SUB_BUCKETS = 16;
+		static const size_t MAX_POWER = 40;
+		static const size_t BUCKETS = SUB_BUCKETS * (MAX_POWER - 2);
+		std::atomic<uint64_t> buckets[BUCKETS];
+		std::atomic<uint64_t> total;
+
+		static size_t msb(uint64_t v) {
+			return 63 - __builtin_clzll(v);
+		}
+
+		static size_t index_of(uint64_t v) {
+			if (v < SUB_BUCKETS) {
+				return v;
+			}
+			size_t m = std::min(msb(v), MAX_POWER);
+			if (m == MAX_POWER) {
+				return BUCKETS - 1;
+			}
+			return SUB_BUCKETS * (m - 3) + ((v >> (m - 4)) & (SUB_BUCKETS - 1));
+		}
+
+		/* Midpoint of the range of values covered by a bucket */
+		static uint64_t value_of(size_t index) {
+			if (index < SUB_BUCKETS) {
+				return index;
+			}
+			size_t m = index / SUB_BUCKETS + 3;
+			uint64_t width = 1ULL << (m - 4);
+			return (SUB_BUCKETS + index % SUB_BUCKETS) * width + width / 2;
+		}
+
+	public:
+		histogram() : total(0) {
+			for (auto& b : buckets) {
+				b.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		void record(uint64_t v) {
+			buckets[index_of(v)].fetch_add(1, std::memory_order_relaxed);
+			total.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/* Value at percentile p (0.0 to 1.0), or 0 if nothing is recorded */
+		uint64_t percentile(double p) const {
+			uint64_t count = total.load(std::memory_order_relaxed);
+			if (count == 0) {
+				return 0;
+			}
+			uint64_t target = std::max<uint64_t>(1, (uint64_t)(p * count + 0.5));
+			uint64_t seen = 0;
+			for (size_t i = 0; i < BUCKETS; ++i) {
+				seen += buckets[i].load(std::memory_order_relaxed);
+				if (seen >= target) {
+					return value_of(i);
+				}
+			}
+			return value_of(BUCKETS - 1);
+		}
+	};
+
+	/* Statistics for one query fingerprint (format string) */
+	struct fingerprint {
+		std::atomic<uint64_t> count = 0;
+		std::atomic<uint64_t> errors = 0;
+		std::atomic<uint64_t> total_us = 0;
+		/* Latency in microseconds */
+		histogram latency;
+		/* Rows returned */
+		histogram rows;
+	};
+
+	/* Maximum number of distinct fingerprints. Queries seen after this is reached are counted under FINGERPRINT_OTHER */
+	const size_t MAX_FINGERPRINTS = 2000;
+	const char* FINGERPRINT_OTHER = "(other queries)";
+
+	/* Protects the fingerprints map. Only taken exclusively when a format
+	 * string is seen for the first time, the statistics themselves are atomic.
+	 */
+	std::shared_mutex fingerprints_mutex;
+
+	/* Per-fingerprint statistics, keyed by normalised query format string */
+	std::unordered_map<std::string, std::unique_ptr<fingerprint>> fingerprints;
+
+	bool is_identifier_char(char c) {
+		return isalnum((unsigned char)c) || c == '_' || c == '$' || c == '`';
+	}
+
+	/**
+	 * Normalise a format string into a fingerprint. Quoted strings and numbers
+	 * become ?, a comma separated run of ? becomes a single ?, and a run of
+	 * identical parenthesised groups (e.g. rows of a multi-row VALUES) becomes
+	 * one group. This keeps queries built with a varying number of
+	 * placeholders, or with ids written into the string, under one entry.
+	 */
+	std::string normalise_format(const std::string &format) {
+		/* Literals to ? */
+		std::string lit;
+		lit.reserve(format.length());
+		for (size_t i = 0; i < format.length(); ++i) {
+			char c = format[i];
+			if (c == '\'' || c == '"') {
+				size_t j = i + 1;
+				while (j < format.length() && (format[j] != c || (j + 1 < format.length() && format[j + 1] == c))) {
+					/* Skip escaped characters, and quotes doubled to escape them */
+					j += (format[j] == '\\' || format[j] == c ? 2 : 1);
+				}
+				lit += '?';
+				i = j;
+			} else if (isdigit((unsigned char)c) && (i == 0 || !is_identifier_char(format[i - 1]))) {
+				while (i + 1 < format.length() && (isalnum((unsigned char)format[i + 1]) || format[i + 1] == '.')) {
+					++i;
+				}
+				lit += '?';
+			} else {
+				lit += c;
+			}
+		}
+		/* Runs of ?, ?, ? to ? */
+		std::string list;
+		list.reserve(lit.length());
+		for (size_t i = 0; i < lit.length(); ++i) {
+			list += lit[i];
+			if (lit[i] == '?') {
+				size_t j = i + 1;
+				while (true) {
+					size_t k = lit.find_first_not_of(" \t\n", j);
+					if (k == std::string::npos || lit[k] != ',') {
+						break;
+					}
+					k = lit.find_first_not_of(" \t\n", k + 1);
+					if (k == std::string::npos || lit[k] != '?') {
+						break;
+					}
+					i = k;
+					j = k + 1;
+				}
+			}
+		}
+		/* Runs of identical (...), (...) groups to one group */
+		std::string out;
+		out.reserve(list.length());
+		std::vector<std::pair<size_t, size_t>> skips;
+		for (size_t i = 0; i < list.length(); ++i) {
+			if (!skips.empty() && skips.back().first == i) {
+				out += list[i];
+				i = skips.back().second;
+				skips.pop_back();
+				continue;
+			}
+			if (list[i] == '(') {
+				int depth = 0;
+				size_t close = i;
+				for (; close < list.length(); ++close) {
+					depth += (list[close] == '(' ? 1 : (list[close] == ')' ? -1 : 0));
+					if (depth == 0) {
+						break;
+					}
+				}
+				if (close < list.length()) {
+					std::string group = list.substr(i, close - i + 1);
+					size_t end = close;
+					while (true) {
+						size_t k = list.find_first_not_of(" \t\n", end + 1);
+						if (k == std::string::npos || list[k] != ',') {
+							break;
+						}
+						k = list.find_first_not_of(" \t\n", k + 1);
+						if (k == std::string::npos || list.compare(k, group.length(), group) != 0) {
+							break;
+						}
+						end = k + group.length() - 1;
+					}
+					if (end != close) {
+						skips.emplace_back(close, end);
+					}
+				}
+			}
+			out += list[i];
+		}
+		return out;
+	}
+
+	/* Find or create the fingerprint for a format string */
+	fingerprint* get_fingerprint(const std::string &raw_format) {
+		std::string format = normalise_format(raw_format);
+		{
+			std::shared_lock fp_lock(fingerprints_mutex);
+			auto i = fingerprints.find(format);
+			if (i != fingerprints.end()) {
+				return i->second.get();
+			}
+		}
+		std::unique_lock fp_lock(fingerprints_mutex);
+		if (fingerprints.size() >= MAX_FINGERPRINTS && fingerprints.find(format) == fingerprints.end()) {
+			format = FINGERPRINT_OTHER;
+		}
+		auto& fp = fingerprints[format];
+		if (!fp) {
+			fp = std::make_unique<fingerprint>();
+		}
+		return fp.get();
+	}
+
+	std::vector<fingerprint_info> get_fingerprint_stats() {
+		std::vector<fingerprint_info> rv;
+		std::shared_lock fp_lock(fingerprints_mutex);
+		for (auto& f : fingerprints) {
+			fingerprint_info fi;
+			fi.format = f.first;
+			fi.count = f.second->count;
+			fi.errors = f.second->errors;
+			fi.total_time = f.second->total_us / 1000000.0;
+			fi.p50 = f.second->latency.percentile(0.50) / 1000000.0;
+			fi.p95 = f.second->latency.percentile(0.95) / 1000000.0;
+			fi.p99 = f.second->latency.percentile(0.99) / 1000000.0;
+			fi.rows_p50 = f.second->rows.percentile(0.50);
+			fi.rows_p95 = f.second->rows.percentile(0.95);
+			fi.rows_p99 = f.second->rows.percentile(0.99);
+			rv.push_back(fi);
+		}
+		std::sort(rv.begin(), rv.end(), [](const fingerprint_info &a, const fingerprint_info &b) {
+			return a.total_time > b.total_time;
+		});
+		return rv;
+	}
+
+	bool dump_fingerprint_stats(const std::string &filename) {
+		std::ofstream dump(filename, std::ios::out | std::ios::trunc);
+		if (!dump.is_open()) {
+			return false;
+		}
+		dump << "count\terrors\ttotal_ms\tp50_ms\tp95_ms\tp99_ms\trows_p50\trows_p95\trows_p99\tquery\n";
+		for (auto& fi : get_fingerprint_stats()) {
+			dump << fmt::format("{}\t{}\t{:.03f}\t{:.03f}\t{:.03f}\t{:.03f}\t{}\t{}\t{}\t{}\n", fi.count, fi.errors, fi.total_time * 1000, fi.p50 * 1000, fi.p95 * 1000, fi.p99 * 1000, fi.rows_p50, fi.rows_p95, fi.rows_p99, fi.format);
+		}
+		return dump.good();
+	}
+
 	resultset real_query(sqlconn &conn, const std::string &format, const paramlist &parameters);
 
+	/* Return the given percentile (0.0 to 1.0) of a sorted list of samples */
+	double percentile(const std::vector<double> &sorted, double p) {
+		if (sorted.empty()) {
+			return 0.0;
+		}
+		size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+		return sorted[std::min(index, sorted.size() - 1)];
+	}
+
 	statistics get_stats() {
 		statistics stats;
-		for (size_t cc = 0; cc < POOL_SIZE; ++cc) {
-			sqlconn& c = connections[cc];
+		for (size_t cc = 0; cc < primary.connections.size(); ++cc) {
+			sqlconn& c = *primary.connections[cc];
 			connection_info ci;
 			ci.ready = !c.busy;
 			ci.queries_errored = c.queries_errored;
@@ -110,6 +517,35 @@ namespace db {
 			std::lock_guard<std::mutex> db_lock(b_db_mutex);
 			stats.bg_queue_length = background_queries.size();
 		}
+		{
+			std::lock_guard<std::mutex> async_lock(async_mutex);
+			stats.async_queue_length = async_queries.size();
+		}
+
+		std::vector<double> waits;
+		{
+			std::lock_guard<std::mutex> pool_lock(primary.mutex);
+			stats.pool_size = primary.connections.size();
+			stats.pool_idle = primary.idle.size();
+			stats.checkouts = primary.checkouts;
+			stats.checkouts_waited = primary.checkouts_waited;
+			stats.checkout_wait_max = primary.checkout_wait_max;
+			waits.assign(primary.wait_samples, primary.wait_samples + std::min<uint64_t>(primary.checkouts, WAIT_SAMPLES));
+		}
+		std::sort(waits.begin(), waits.end());
+		stats.checkout_wait_p50 = percentile(waits, 0.50);
+		stats.checkout_wait_p95 = percentile(waits, 0.95);
+		stats.checkout_wait_p99 = percentile(waits, 0.99);
+
+		for (replica* r : replicas) {
+			replica_info ri;
+			ri.host = fmt::format("{}:{}", r->host, r->port);
+			ri.healthy = r->healthy;
+			ri.lag = r->lag;
+			ri.queries = r->queries;
+			stats.replicas.push_back(ri);
+		}
+		stats.ro_fallbacks = ro_fallbacks;
 
 		connection_info ci;
 		ci.ready = !bg_connection.busy;
@@ -141,42 +577,214 @@ namespace db {
 				background_query q = bg_copy.front();
 				processed++;
 				bg_connection.queries_processed++;
+				bg_connection.busy = true;
 				real_query(bg_connection, q.format, q.parameters);
+				bg_connection.busy = false;
 				bg_copy.pop();
 			}
 		}
 	}
 
+	/**
+	 * Pool thread for asynchronous queries. Each query checks out a foreground
+	 * connection like db::query() does, and the callback is called on this
+	 * thread once the connection has been returned to the pool.
+	 */
+	void asyncthread() {
+		while (true) {
+			async_query q;
+			{
+				std::unique_lock<std::mutex> async_lock(async_mutex);
+				async_cv.wait(async_lock, [] { return !async_queries.empty(); });
+				q = std::move(async_queries.front());
+				async_queries.pop_front();
+				async_running.insert(q.owner);
+			}
+			resultset rv = q.read_only ? query_ro(q.format, q.parameters) : query(q.format, q.parameters);
+			if (q.callback) {
+				try {
+					q.callback(rv);
+				}
+				catch (const std::exception &e) {
+					log->log(dpp::ll_error, fmt::format("Exception in async query callback: {} on query {}", e.what(), q.format));
+				}
+			}
+			{
+				std::lock_guard<std::mutex> async_lock(async_mutex);
+				/* Destroy the callback before the owner is told it may go away, it may hold the owner's objects */
+				q.callback = nullptr;
+				async_running.erase(async_running.find(q.owner));
+			}
+			async_done_cv.notify_all();
+		}
+	}
+
+	void cancel_async(const void* owner) {
+		std::unique_lock<std::mutex> async_lock(async_mutex);
+		async_queries.erase(std::remove_if(async_queries.begin(), async_queries.end(), [owner](const async_query &q) {
+			return q.owner == owner;
+		}), async_queries.end());
+		async_done_cv.wait(async_lock, [owner] { return async_running.find(owner) == async_running.end(); });
+	}
+
+	/**
+	 * Initialise and connect one connection, returns false if there was an error.
+	 * If the connection has been opened before it is closed first. The caller
+	 * must hold the connection's mutex if any other thread may be using it.
+	 */
+	bool open_connection(sqlconn* conn, const std::string &host, int port) {
+		if (conn->initialised) {
+			mysql_close(&conn->connection);
+			conn->initialised = false;
+		}
+		conn->connected = false;
+		if (mysql_init(&conn->connection) != nullptr) {
+			conn->initialised = true;
+			mysql_options(&conn->connection, MYSQL_SET_CHARSET_NAME, "utf8mb4");
+			mysql_options(&conn->connection, MYSQL_INIT_COMMAND, CONNECT_STRING);
+			char reconnect = 1;
+			if (mysql_options(&conn->connection, MYSQL_OPT_RECONNECT, &reconnect) == 0) {
+				if (!mysql_real_connect(&conn->connection, host.c_str(), db_user.c_str(), db_pass.c_str(), db_name.c_str(), port, NULL, CLIENT_MULTI_RESULTS | CLIENT_MULTI_STATEMENTS)) {
+					std::cout << mysql_error(&conn->connection) << "\n";
+					log->log(dpp::ll_error, fmt::format("Database connection to {}:{} failed {}", host, port, mysql_error(&conn->connection)));
+					return false;
+				}
+			}
+		}
+		conn->connected = true;
+		return true;
+	}
+
+	/**
+	 * Fill a pool with connections, returns false if any connection failed.
+	 * If the pool already has connections (reconnecting after the cluster was
+	 * restarted) they are reconnected in place, as other threads may still
+	 * have them checked out. Other threads index the connection list without
+	 * holding the pool mutex, so once filled the pool is never resized.
+	 */
+	bool open_pool(pool &p, size_t size, const std::string &host, int port) {
+		std::vector<sqlconn*> existing;
+		{
+			std::lock_guard<std::mutex> pool_lock(p.mutex);
+			existing = p.connections;
+		}
+		bool failed = false;
+		for (sqlconn* conn : existing) {
+			std::lock_guard<std::mutex> db_lock(conn->mutex);
+			if (!open_connection(conn, host, port)) {
+				failed = true;
+			}
+		}
+		for (size_t i = 0; existing.empty() && i < size; ++i) {
+			sqlconn* conn = new sqlconn();
+			if (!open_connection(conn, host, port)) {
+				failed = true;
+			}
+			std::lock_guard<std::mutex> pool_lock(p.mutex);
+			p.connections.push_back(conn);
+			p.idle.push_back(p.connections.size() - 1);
+		}
+		p.cv.notify_all();
+		return !failed;
+	}
+
+	/**
+	 * Check each replica's health and replication lag every few seconds.
+	 * A replica that is not replicating from anything (e.g. a second local
+	 * instance used for testing) reports no status rows and is treated as
+	 * having no lag.
+	 */
+	void replicathread() {
+		while (true) {
+			for (replica* r : replicas) {
+				size_t c = r->connections.checkout();
+				sqlconn* conn = r->connections.connections[c];
+				/* A handle which never connected, or lost its connection, can't reconnect by itself */
+				if (!conn->connected) {
+					std::lock_guard<std::mutex> db_lock(conn->mutex);
+					open_connection(conn, r->host, r->port);
+				}
+				conn->queries_processed++;
+				resultset status = real_query(*conn, REPLICA_STATUS, {});
+				unsigned int status_errno = conn->last_errno;
+				if (status_errno >= CR_MIN_ERROR) {
+					conn->connected = false;
+				}
+				r->connections.checkin(c);
+				bool was_healthy = r->healthy;
+				if (status_errno != 0) {
+					r->healthy = false;
+				} else if (status.empty()) {
+					r->lag = 0.0;
+					r->healthy = true;
+				} else if (status[0][REPLICA_LAG_FIELD].empty()) {
+					/* NULL lag means the replication threads are stopped */
+					r->healthy = false;
+				} else {
+					r->lag = from_string<double>(status[0][REPLICA_LAG_FIELD], std::dec);
+					r->healthy = true;
+				}
+				if (was_healthy != r->healthy) {
+					log->log(r->healthy ? dpp::ll_info : dpp::ll_warning, fmt::format("Replica {}:{} is now {}", r->host, r->port, r->healthy ? "up" : "down"));
+				}
+				/* Once the replica is reachable again, reopen the rest of its connections */
+				if (status_errno == 0) {
+					for (sqlconn* other : r->connections.connections) {
+						if (!other->connected) {
+							std::lock_guard<std::mutex> db_lock(other->mutex);
+							open_connection(other, r->host, r->port);
+						}
+					}
+				}
+			}
+			std::this_thread::sleep_for(std::chrono::seconds(5));
+		}
+	}
+
 	/**
 	 * Connect to mysql database, returns false if there was an error.
+	 * A replica which can't be connected to does not cause an error, it will
+	 * be marked as unhealthy and read-only queries will go to the primary.
 	 */
-	bool connect(dpp::cluster* logger, const std::string &host, const std::string &user, const std::string &pass, const std::string &db, int port) {
+	bool connect(dpp::cluster* logger, const std::string &host, const std::string &user, const std::string &pass, const std::string &db, int port, size_t poolsize, const std::vector<std::string> &replica_hosts, double max_lag) {
 		std::lock_guard<std::mutex> db_lock2(b_db_mutex);
 		log = logger;
-		bool failed = false;
-		for (size_t i = 0; i < POOL_SIZE; ++i) {
-			if (mysql_init(&connections[i].connection) != nullptr) {
-				mysql_options(&connections[i].connection, MYSQL_SET_CHARSET_NAME, "utf8mb4");
-				mysql_options(&connections[i].connection, MYSQL_INIT_COMMAND, CONNECT_STRING);
-				char reconnect = 1;
-				if (mysql_options(&connections[i].connection, MYSQL_OPT_RECONNECT, &reconnect) == 0) {
-					if (!mysql_real_connect(&connections[i].connection, host.c_str(), user.c_str(), pass.c_str(), db.c_str(), port, NULL, CLIENT_MULTI_RESULTS | CLIENT_MULTI_STATEMENTS)) {
-						failed = true;
-						std::cout << mysql_error(&connections[i].connection) << "\n";
-						logger->log(dpp::ll_error, "Database connection failed " + std::string(mysql_error(&connections[i].connection)));
-						break;
-					}
+		db_user = user;
+		db_pass = pass;
+		db_name = db;
+		pool_size = std::max<size_t>(poolsize, 1);
+		max_replica_lag = max_lag;
+		bool failed = !open_pool(primary, pool_size, host, port);
+
+		/* Replicas are only set up once, on restart of the cluster their existing connections are reused */
+		if (replicas.empty()) {
+			for (const std::string &spec : replica_hosts) {
+				replica* r = new replica();
+				r->host = spec;
+				if (spec.find(':') != std::string::npos) {
+					r->host = spec.substr(0, spec.find(':'));
+					r->port = from_string<int>(spec.substr(spec.find(':') + 1), std::dec);
 				}
+				r->healthy = open_pool(r->connections, std::max<size_t>(pool_size / 2, 2), r->host, r->port);
+				logger->log(dpp::ll_info, fmt::format("Read replica {}:{} added ({})", r->host, r->port, r->healthy ? "up" : "down"));
+				replicas.push_back(r);
+			}
+			if (!replicas.empty()) {
+				replica_thread = new std::thread(replicathread);
 			}
 		}
 
-		if (mysql_init(&bg_connection.connection) != nullptr) {
-			mysql_options(&bg_connection.connection, MYSQL_SET_CHARSET_NAME, "utf8mb4");
-			mysql_options(&bg_connection.connection, MYSQL_INIT_COMMAND, CONNECT_STRING);
-			char reconnect = 1;
-			if (mysql_options(&bg_connection.connection, MYSQL_OPT_RECONNECT, &reconnect) == 0) {
-				background_thread = new std::thread(bgthread);
-				return !failed && mysql_real_connect(&bg_connection.connection, host.c_str(), user.c_str(), pass.c_str(), db.c_str(), port, NULL, CLIENT_MULTI_RESULTS | CLIENT_MULTI_STATEMENTS);
+		while (async_threads.size() < pool_size) {
+			async_threads.push_back(new std::thread(asyncthread));
+		}
+
+		if (!background_thread) {
+			background_thread = new std::thread(bgthread);
+		}
+		{
+			std::lock_guard<std::mutex> db_lock(bg_connection.mutex);
+			if (!open_connection(&bg_connection, host, port)) {
+				failed = true;
 			}
 		}
 
@@ -188,11 +796,18 @@ namespace db {
 	 * If there's an error, there isn't much we can do about it anyway.
 	 */
 	bool close() {
-		for (size_t i = 0; i < POOL_SIZE; ++i) {
-			std::lock_guard<std::mutex> db_lock(connections[i].mutex);
-			mysql_close(&connections[i].connection);
+		std::vector<sqlconn*> all = primary.connections;
+		for (replica* r : replicas) {
+			all.insert(all.end(), r->connections.connections.begin(), r->connections.connections.end());
+		}
+		all.push_back(&bg_connection);
+		for (sqlconn* conn : all) {
+			std::lock_guard<std::mutex> db_lock(conn->mutex);
+			if (conn->initialised) {
+				mysql_close(&conn->connection);
+				conn->initialised = conn->connected = false;
+			}
 		}
-		mysql_close(&bg_connection.connection);
 		return true;
 	}
 
@@ -201,6 +816,14 @@ namespace db {
 		background_queries.emplace(background_query{ format, parameters });
 	}
 
+	void query_async(const std::string &format, const paramlist &parameters, query_callback callback, const void* owner) {
+		{
+			std::lock_guard<std::mutex> async_lock(async_mutex);
+			async_queries.emplace_back(async_query{ format, parameters, callback, false, owner });
+		}
+		async_cv.notify_one();
+	}
+
 	/**
 	 * Run a mysql query, with automatic escaping of parameters to prevent SQL injection.
 	 * The parameters given should be a vector of strings. You can instantiate this using "{}".
@@ -208,31 +831,86 @@ namespace db {
 	 * Returns a resultset of the results as rows. Avoid returning massive resultsets if you can.
 	 */
 	resultset query(const std::string &format, const paramlist &parameters) {
-		size_t c = 0;
-		size_t tries = 0;
-		if (curr_index >= POOL_SIZE) {
-			curr_index = c = 0;
-		} else {
-			c = curr_index++;
-		}
-		while (tries < POOL_SIZE + 1 && connections[c].busy) {
-			log->log(dpp::ll_debug, fmt::format("Skipped busy connection {}", c));
-			c = ++curr_index;
-			if (curr_index >= POOL_SIZE) {
-				c = curr_index = 0;
+		size_t c = primary.checkout();
+		sqlconn* conn = primary.connections[c];
+		processed++;
+		conn->queries_processed++;
+		resultset rv = real_query(*conn, format, parameters);
+		last_failed = (conn->last_errno != 0);
+		primary.checkin(c);
+		return rv;
+	}
+
+	bool failed() {
+		return last_failed;
+	}
+
+	/**
+	 * Returns true if a query only reads data and can safely run on a replica.
+	 * Locking reads take their locks on the server they run on, so they must
+	 * go to the primary.
+	 */
+	bool is_read_only(const std::string &format) {
+		std::string q = lowercase(trim(format));
+		std::string verb = q.substr(0, 5);
+		if (verb == "show ") {
+			return true;
+		}
+		return verb == "selec" && q.find("for update") == std::string::npos && q.find("for share") == std::string::npos && q.find("lock in share mode") == std::string::npos;
+	}
+
+	/**
+	 * Run a read-only query on a healthy replica, chosen round-robin.
+	 * If there are no replicas, none are healthy and within the lag limit,
+	 * the query writes data, or the replica connection is lost mid-query,
+	 * the query is run on the primary instead.
+	 */
+	resultset query_ro(const std::string &format, const paramlist &parameters) {
+		if (!replicas.empty() && is_read_only(format)) {
+			size_t start = next_replica++;
+			for (size_t n = 0; n < replicas.size(); ++n) {
+				replica* r = replicas[(start + n) % replicas.size()];
+				if (!r->healthy || r->lag > max_replica_lag) {
+					continue;
+				}
+				size_t c = r->connections.checkout();
+				sqlconn* conn = r->connections.connections[c];
+				processed++;
+				r->queries++;
+				conn->queries_processed++;
+				resultset rv = real_query(*conn, format, parameters);
+				unsigned int error = conn->last_errno;
+				r->connections.checkin(c);
+				/* Client side error codes (2000+) mean the connection to the replica itself failed */
+				if (error < CR_MIN_ERROR) {
+					last_failed = (error != 0);
+					return rv;
+				}
+				conn->connected = false;
+				r->healthy = false;
+				log->log(dpp::ll_warning, fmt::format("Replica {}:{} failed, falling back to primary", r->host, r->port));
+				break;
 			}
-			tries++;
+			ro_fallbacks++;
 		}
-		processed++;
-		connections[c].queries_processed++;
-		return real_query(connections[c], format, parameters);
+		return query(format, parameters);
 	}
 
-	resultset real_query(sqlconn& conn, const std::string &format, const paramlist &parameters) {
+	void query_ro_async(const std::string &format, const paramlist &parameters, query_callback callback, const void* owner) {
+		{
+			std::lock_guard<std::mutex> async_lock(async_mutex);
+			async_queries.emplace_back(async_query{ format, parameters, callback, true, owner });
+		}
+		async_cv.notify_one();
+	}
 
-		std::vector<std::string> escaped_parameters;
+	/**
+	 * Escape parameters and substitute them into the format string.
+	 * Returns false if a parameter could not be escaped.
+	 */
+	bool build_query(sqlconn& conn, const std::string &format, const paramlist &parameters, std::string &querystring) {
 
-		resultset rv;
+		std::vector<std::string> escaped_parameters;
 
 		/**
 		 * Escape all parameters properly from a vector of std::variant
@@ -255,13 +933,10 @@ namespace db {
 
 		if (parameters.size() != escaped_parameters.size()) {
 			log->log(dpp::ll_error, "Parameter wasn't escaped: " + std::string(mysql_error(&conn.connection)));
-			errored++;
-			conn.queries_errored++;
-			return rv;
+			return false;
 		}
 
 		unsigned int param = 0;
-		std::string querystring;
 
 		/**
 		 * Search and replace escaped parameters in the query string.
@@ -279,16 +954,34 @@ namespace db {
 				querystring += *v;
 			}
 		}
+		return true;
+	}
+
+	resultset real_query(sqlconn& conn, const std::string &format, const paramlist &parameters) {
+
+		resultset rv;
+		std::string querystring;
+
+		fingerprint* fp = get_fingerprint(format);
+		fp->count++;
+
+		if (!build_query(conn, format, parameters, querystring)) {
+			errored++;
+			conn.queries_errored++;
+			fp->errors++;
+			conn.last_errno = mysql_errno(&conn.connection) ? mysql_errno(&conn.connection) : CR_UNKNOWN_ERROR;
+			return rv;
+		}
 
 		{
 			/**
 			 * One DB handle can't query the database from multiple threads at the same time.
 			 * To prevent corruption of results, put a lock guard on queries.
 			 */
-			conn.busy = true;
 			double busy_start = dpp::utility::time_f();
 			std::lock_guard<std::mutex> db_lock(conn.mutex);
 			int result = mysql_query(&conn.connection, querystring.c_str());
+			conn.last_errno = (result == 0 ? 0 : mysql_errno(&conn.connection));
 			/**
 			 * On successful query collate results into a std::map
 			 */
@@ -322,12 +1015,121 @@ namespace db {
 				log->log(dpp::ll_error, fmt::format("SQL Error: {} on query {}", mysql_error(&conn.connection), querystring));
 				errored++;
 				conn.queries_errored++;
+				fp->errors++;
 			}
+			double query_time = dpp::utility::time_f() - busy_start;
+			fp->total_us += (uint64_t)(query_time * 1000000);
+			fp->latency.record((uint64_t)(query_time * 1000000));
+			fp->rows.record(rv.size());
 			conn.busy_time += (dpp::utility::time_f() - busy_start);
 			conn.avg_query_length -= conn.avg_query_length / conn.queries_processed;
 			conn.avg_query_length += (dpp::utility::time_f() - busy_start) / conn.queries_processed;
-			conn.busy = false;
 		}
 		return rv;
 	}
+
+	/**
+	 * Run a string of one or more statements on a connection, discarding any
+	 * results. Returns false if any statement failed, in which case the
+	 * statements after it were not executed.
+	 */
+	bool real_multi_query(sqlconn& conn, const std::string &querystring) {
+		std::lock_guard<std::mutex> db_lock(conn.mutex);
+		int status = mysql_query(&conn.connection, querystring.c_str());
+		if (status == 0) {
+			do {
+				MYSQL_RES *a_res = mysql_store_result(&conn.connection);
+				if (a_res) {
+					mysql_free_result(a_res);
+				}
+			} while ((status = mysql_next_result(&conn.connection)) == 0);
+			/* -1 means no more results, greater than zero is an error in a later statement */
+			if (status == -1) {
+				conn.last_errno = 0;
+				return true;
+			}
+		}
+		conn.last_errno = mysql_errno(&conn.connection);
+		log->log(dpp::ll_error, fmt::format("SQL Error: {} on query {}", mysql_error(&conn.connection), querystring));
+		return false;
+	}
+
+	transaction::transaction() : conn(primary.checkout()), started(false), finished(false), failed(false) {
+	}
+
+	transaction::~transaction() {
+		if (!finished) {
+			rollback();
+		}
+		primary.checkin(conn);
+	}
+
+	resultset transaction::query(const std::string &format, const paramlist &parameters) {
+		sqlconn* c = primary.connections[conn];
+		if (!started) {
+			processed++;
+			c->queries_processed++;
+			real_query(*c, "START TRANSACTION", {});
+			started = true;
+		}
+		processed++;
+		c->queries_processed++;
+		resultset rv = real_query(*c, format, parameters);
+		if (c->last_errno != 0) {
+			failed = true;
+		}
+		return rv;
+	}
+
+	void transaction::add(const std::string &format, const paramlist &parameters) {
+		std::string querystring;
+		if (!build_query(*primary.connections[conn], format, parameters, querystring)) {
+			failed = true;
+			return;
+		}
+		batch += querystring + ";\n";
+		/* Each distinct statement is named once, so a batch of any size has the same fingerprint */
+		if (formats.find(format + "; ") == std::string::npos) {
+			formats += format + "; ";
+		}
+	}
+
+	bool transaction::commit() {
+		if (finished) {
+			return false;
+		}
+		if (failed) {
+			rollback();
+			return false;
+		}
+		sqlconn* c = primary.connections[conn];
+		fingerprint* fp = get_fingerprint(formats + "COMMIT");
+		fp->count++;
+		processed++;
+		c->queries_processed++;
+		double start = dpp::utility::time_f();
+		bool ok = real_multi_query(*c, (started ? "" : "START TRANSACTION;\n") + batch + "COMMIT");
+		double query_time = dpp::utility::time_f() - start;
+		fp->total_us += (uint64_t)(query_time * 1000000);
+		fp->latency.record((uint64_t)(query_time * 1000000));
+		fp->rows.record(0);
+		c->busy_time += query_time;
+		started = true;
+		if (!ok) {
+			errored++;
+			c->queries_errored++;
+			fp->errors++;
+			rollback();
+			return false;
+		}
+		finished = true;
+		return true;
+	}
+
+	void transaction::rollback() {
+		if (started) {
+			real_multi_query(*primary.connections[conn], "ROLLBACK");
+		}
+		finished = true;
+	}
 };
@@ -91,6 +91,17 @@ std::string Bot::GetConfig(const std::string &name) {
 	return configdocument[name].get<std::string>();
 }
 
+/**
+ * Returns the named value from config.json as a string, or the given default if it is not present
+ */
+std::string Bot::GetConfig(const std::string &name, const std::string &def) {
+	auto i = configdocument.find(name);
+	if (i == configdocument.end() || i->is_null()) {
+		return def;
+	}
+	return i->is_string() ? i->get<std::string>() : i->dump();
+}
+
 /**
  * Returns true if the bot is running in development mode (different token)
  */
@@ -331,8 +342,18 @@ int main(int argc, char** argv) {
 		/* Construct cluster */
 		dpp::cluster bot(token, intents, dev ? 1 : from_string<uint32_t>(Bot::GetConfig("shardcount"), std::dec), clusterid, maxclusters, true, cp);
 
+		/* Optional comma separated list of read replicas, "host" or "host:port" */
+		std::vector<std::string> replicas;
+		std::stringstream replicalist(Bot::GetConfig("dbreplicas", ""));
+		std::string replica;
+		while (std::getline(replicalist, replica, ',')) {
+			if (!trim(replica).empty()) {
+				replicas.push_back(trim(replica));
+			}
+		}
+
 		/* Connect to SQL database */
-		if (!db::connect(&bot, Bot::GetConfig("dbhost"), Bot::GetConfig("dbuser"), Bot::GetConfig("dbpass"), Bot::GetConfig("dbname"), from_string<uint32_t>(Bot::GetConfig("dbport"), std::dec))) {
+		if (!db::connect(&bot, Bot::GetConfig("dbhost"), Bot::GetConfig("dbuser"), Bot::GetConfig("dbpass"), Bot::GetConfig("dbname"), from_string<uint32_t>(Bot::GetConfig("dbport"), std::dec), from_string<uint32_t>(Bot::GetConfig("dbpoolsize", std::to_string(db::DEFAULT_POOL_SIZE)), std::dec), replicas, from_string<double>(Bot::GetConfig("dbreplicamaxlag", std::to_string(db::DEFAULT_MAX_REPLICA_LAG)), std::dec))) {
 			std::cerr << "Database connection failed\n";
 			exit(2);
 		}
@@ -259,6 +259,34 @@ bool ModuleLoader::Reload(const std::string &filename)
 	return (Unload(filename) && Load(filename));
 }
 
+/**
+ * Store serialised data for the next instance of a module. This doesn't lock mtx, as it
+ * is called from module destructors within Unload(), which already holds it.
+ */
+void ModuleLoader::SetHandoff(const std::string &name, const std::string &data)
+{
+	std::lock_guard l(handoff_mtx);
+	handoff[name] = std::make_pair(time(NULL), data);
+}
+
+/**
+ * Retrieve and remove serialised data left by a previous instance of a module
+ */
+std::string ModuleLoader::TakeHandoff(const std::string &name, time_t max_age)
+{
+	std::lock_guard l(handoff_mtx);
+	auto h = handoff.find(name);
+	if (h == handoff.end()) {
+		return "";
+	}
+	std::string data;
+	if (time(NULL) - h->second.first <= max_age) {
+		data = std::move(h->second.second);
+	}
+	handoff.erase(h);
+	return data;
+}
+
 /**
  * Load all modules from the config file modules.json
  */